@@ -212,3 +212,20 @@ void DriverACIA::InterruptReceive()
 	}
 #endif
 }
+
+//-------------------------------------------------------------------------
+// DriverACIA::CanReceive()
+/*! Tell whether TtyReceive can start at once: in the Interrupt mode,
+  a whole message has been received; in the Busy Waiting mode, the
+  first character of a message is in the input register. Used to
+  wait for several devices at a time (see SC_SELECT). Only the
+  Interrupt mode wakes up the waiting threads when a message arrives.
+  */
+//-------------------------------------------------------------------------
+
+bool DriverACIA::CanReceive()
+{
+	if(g_cfg->ACIA == ACIA_INTERRUPT)
+		return receive_sema->IsAvailable();
+	return g_machine->acia->GetInputStateReg() == FULL;
+}
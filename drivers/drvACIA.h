@@ -56,6 +56,9 @@ class DriverACIA{
   
   //! Reception interrupt handler. Used in the ACIA Interrupt mode only
   void InterruptReceive();
+
+  //! True if a message (Interrupt mode) or a character (Busy Waiting mode) was received
+  bool CanReceive();
 };
 #endif // _ACIA_HDL
 
@@ -51,6 +51,7 @@ DriverConsole::DriverConsole(){
   put = new Semaphore((char*)"put",0);
   mutexget = new Lock((char*)"mutex get");
   mutexput = new Lock((char*)"mutex put");
+  nb_pollers = 0;
 }
 
 
@@ -137,7 +138,7 @@ void DriverConsole::GetString(char *buffer,int nbcar) {
   int i;
 
   mutexget->Acquire();
-  g_machine->console->EnableInterrupt();
+  StartPolling();
   
   for (i=0;((i<nbcar) && (c!='\n'));i++) {
     g_current_thread->GetProcessOwner()->stat->incrNumCharRead();
@@ -147,7 +148,32 @@ void DriverConsole::GetString(char *buffer,int nbcar) {
   }
   buffer[i] = 0;
 
-  g_machine->console->DisableInterrupt();
+  StopPolling();
   mutexget->Release();
 
 }
+
+//-----------------------------------------------------------------
+// DriverConsole::StartPolling
+/*!     Enable the console input interrupts for the calling thread,
+//      which reads the console or waits for a character among other
+//      events (see SC_SELECT). The interrupts stay enabled until all
+//      these threads have called StopPolling.
+*/
+//-----------------------------------------------------------------
+void DriverConsole::StartPolling() {
+  if (nb_pollers++ == 0)
+    g_machine->console->EnableInterrupt();
+}
+
+//-----------------------------------------------------------------
+// DriverConsole::StopPolling
+/*!     Disable the console input interrupts, when no other thread
+//      needs them.
+*/
+//-----------------------------------------------------------------
+void DriverConsole::StopPolling() {
+  ASSERT(nb_pollers > 0);
+  if (--nb_pollers == 0)
+    g_machine->console->DisableInterrupt();
+}
@@ -39,10 +39,15 @@ class DriverConsole {
   void GetAChar();           // Send a char to the console device
   void PutAChar();           // Receive e char from the console
 
+  void StartPolling();       // Enable the console input interrupts
+  void StopPolling();        // Disable them, unless another thread needs them
+  bool CharAvailable() { return get->IsAvailable(); } // A char was received but not read
+
 private:
   Lock *mutexget;            //!< Lock on read operations
   Lock *mutexput;            //!< Lock on write operations
   Semaphore *get, *put;      //!< Semaphores to wait for interrupts
+  int nb_pollers;            //!< Threads which need the console input interrupts
 };
     
 void ConsoleGet();
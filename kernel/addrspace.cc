@@ -27,6 +27,8 @@
 #include "filesys/filehdr.h"
 #include "filesys/openfile.h"
 #include "vm/physMem.h"
+#include "vm/pagefaultmanager.h"
+#include "userlib/syscall.h"
 #include "kernel/elf32.h"
 #include "kernel/addrspace.h"
 
@@ -144,22 +146,33 @@ AddrSpace::AddrSpace(OpenFile * exec_file, Process *p, int *err)
 		// Make sure section is aligned on page boundary
 		ASSERT((section_table[i].sh_addr % g_cfg->PageSize)==0);
 
+		// Describe the section by a region of the address space. The
+		// SHT_NOBITS flag indicates if the section has an image in the
+		// executable file (text or data section) or not (bss section)
+		int prot = REGION_READ;
+		if (section_table[i].sh_flags & SHF_WRITE)
+			prot |= REGION_WRITE;
+		if (section_table[i].sh_flags & SHF_EXECINSTR)
+			prot |= REGION_EXEC;
+		Region *r;
+		if (section_table[i].sh_type != SHT_NOBITS)
+			r = new Region(section_table[i].sh_addr / g_cfg->PageSize,
+				       divRoundUp(section_table[i].sh_size, g_cfg->PageSize),
+				       prot, REGION_FILE, exec_file,
+				       section_table[i].sh_offset, section_table[i].sh_size);
+		else
+			r = new Region(section_table[i].sh_addr / g_cfg->PageSize,
+				       divRoundUp(section_table[i].sh_size, g_cfg->PageSize),
+				       prot, REGION_ANON);
+		AddRegion(r);
 
-		// Initializes the page table entries and loads the section
-		// in memory (demand paging will be implemented later on)
-		for (unsigned int pgdisk = 0, virt_page = section_table[i].sh_addr / g_cfg->PageSize; pgdisk < divRoundUp(section_table[i].sh_size, g_cfg->PageSize); pgdisk++, virt_page ++)
+#ifndef ETUDIANTS_TP
+		// Loads the section in memory (demand paging will be
+		// implemented later on)
+		for (int virt_page = r->first_page; virt_page < r->EndPage(); virt_page++)
 		{
-
 			/* Without demand paging */
 
-			// Set up default values for the page table entry
-			translationTable->clearBitSwap(virt_page);
-			translationTable->setBitReadAllowed(virt_page);
-			if (section_table[i].sh_flags & SHF_WRITE)
-				translationTable->setBitWriteAllowed(virt_page);
-			else translationTable->clearBitWriteAllowed(virt_page);
-				translationTable->clearBitIo(virt_page);
-#ifndef ETUDIANTS_TP
 			// Get a page in physical memory, halt of there is not sufficient space
 			int pp = g_physical_mem_manager->FindFreePage();
 			if (pp == -1)
@@ -173,54 +186,21 @@ AddrSpace::AddrSpace(OpenFile * exec_file, Process *p, int *err)
 			g_physical_mem_manager->tpr[pp].locked=true;
 			translationTable->setPhysicalPage(virt_page,pp);
 
-			// The SHT_NOBITS flag indicates if the section has an image
-			// in the executable file (text or data section) or not 
-			// (bss section)
-			if (section_table[i].sh_type != SHT_NOBITS)
-			{
-				// The section has an image in the executable file
-				// Read it from the disk
-				exec_file->ReadAt((char *)&(g_machine->mainMemory[translationTable->getPhysicalPage(virt_page)*g_cfg->PageSize]), g_cfg->PageSize, section_table[i].sh_offset + pgdisk*g_cfg->PageSize);
-			}
-			else
-			{
-				// The section does not have an image in the executable
-				// Fill it with zeroes
-				memset(&(g_machine->mainMemory[translationTable->getPhysicalPage(virt_page)*g_cfg->PageSize]), 0, g_cfg->PageSize);
-			}
+			// Read the page from the executable file, or fill it with zeroes
+			r->ReadPage(virt_page, (char *)&(g_machine->mainMemory[pp*g_cfg->PageSize]));
 
-			// The page has been loaded in physical memory but
-			// later-on will be saved in the swap disk. We have to indicate this
-			// in the translation table
-			translationTable->setAddrDisk(virt_page,-1);
-#endif
-#ifdef ETUDIANTS_TP
-			if (section_table[i].sh_type != SHT_NOBITS)
-			{
-				translationTable->setAddrDisk(virt_page, section_table[i].sh_offset + pgdisk*g_cfg->PageSize);
-			}
-			else
-			{
-				translationTable->setAddrDisk(virt_page,-1);
-			}
-			translationTable->clearBitValid(virt_page);
-#endif
-#ifndef ETUDIANTS_TP
 			// The entry is valid
 			translationTable->setBitValid(virt_page);
-#endif
 
 			/* End of code without demand paging */
 		}
+#endif
 	}
 	delete [] shnames;
 
 	// Get program start address
 	CodeStartAddress = (int32_t)elfHdr.e_entry;
 	printf("\t- Program start address : 0x%lx\n\n", (unsigned long)CodeStartAddress);
-
-	// Init the number of memory mapped files to zero
-	nb_mapped_files = 0;
 }
 
 //----------------------------------------------------------------------
@@ -230,60 +210,135 @@ AddrSpace::AddrSpace(OpenFile * exec_file, Process *p, int *err)
 //----------------------------------------------------------------------
 AddrSpace::~AddrSpace()
 {
-  int i;
+  Region *r;
 
   if (translationTable != NULL) {
-    
-    // For every virtual page
-    for (i = 0 ; i <  freePageId ; i++) {
-      
-      // If it is in physical memory, free the physical page
-      if (translationTable->getBitValid(i))
-	g_physical_mem_manager->RemovePhysicalToVirtualMapping(translationTable->getPhysicalPage(i));
-      // If it is in the swap disk, free the corresponding disk sector
-      if (translationTable->getBitSwap(i)) {
-	int addrDisk = translationTable->getAddrDisk(i);
-	if (addrDisk >= 0) {
-	  g_swap_manager->ReleasePageSwap(translationTable->getAddrDisk(i));
-	}  
-      }
+
+    // For every region, free its pages (RAM and swap area)
+    while ((r = regions.FirstOverlap(0, translationTable->getMaxNumPages())) != NULL) {
+      ReleasePages(r, r->first_page, r->EndPage());
+      regions.Remove(r);
+      delete r;
     }
     delete translationTable;
   }
+
+  while (!free_stacks.IsEmpty())
+    free_stacks.Remove();
+}
+
+//----------------------------------------------------------------------
+/** Free the physical pages and swap sectors of virtual pages of a
+ *  region, and make the pages unaccessible. Modified pages of a
+ *  shared file mapping are written back to the file.
+ *
+ * \param r: the region containing the pages, or NULL if they are not
+ *        in any region
+ * \param first_page: first virtual page to free
+ * \param end_page: first virtual page after the pages to free
+ */
+//----------------------------------------------------------------------
+void AddrSpace::ReleasePages(Region *r, int first_page, int end_page)
+{
+  for (int i = first_page ; i < end_page ; i++) {
+
+    // If it is in physical memory, free the physical page
+    if (translationTable->getBitValid(i)) {
+      int pp = translationTable->getPhysicalPage(i);
+      // Modified pages of a shared file mapping go back to the file
+      if (r != NULL && r->shared && translationTable->getBitM(i))
+	r->WritePage(i, (char *)&(g_machine->mainMemory[pp*g_cfg->PageSize]));
+      g_physical_mem_manager->RemovePhysicalToVirtualMapping(pp);
+    }
+    // If it is in the swap disk, free the corresponding disk sector
+    if (translationTable->getBitSwap(i)) {
+      int addrDisk = translationTable->getAddrDisk(i);
+      if (addrDisk >= 0) {
+	g_swap_manager->ReleasePageSwap(addrDisk);
+      }
+      translationTable->clearBitSwap(i);
+    }
+    translationTable->setAddrDisk(i,-1);
+    translationTable->clearBitReadAllowed(i);
+    translationTable->clearBitWriteAllowed(i);
+  }
 }
 
 //----------------------------------------------------------------------
-/**	Allocates a new stack of size g_cfg->UserStackSize
+/**	Allocates a new stack of initial size g_cfg->UserStackInitSize
+ *
+ *      The virtual area of a stack is made of:
+ *      - STACK_BLANK_LEN unmapped pages, to detect stack overflows
+ *      - pages reserved for the growth of the stack, up to
+ *        g_cfg->UserStackSize. They are accessible in the translation
+ *        table but do not belong to any region: a page fault on one of
+ *        them makes the stack region grow down to it (see GrowStack)
+ *      - the stack region itself, of size g_cfg->UserStackInitSize
  *
  *      Allocation is done by calling Alloc, a very simple
- *      allocation procedure of virtual memory areas.
+ *      allocation procedure of virtual memory areas, or by reusing
+ *      the area of the stack of a finished thread.
  *
  *      \return stack pointer (at the end of the allocated stack)
  */
 //----------------------------------------------------------------------
 int AddrSpace::StackAllocate(void)
 {
-  // Optional : leave an anmapped blank space below the stack to
-  // detect stack overflows
+  // Leave an unmapped blank space below the stack to detect stack
+  // overflows
 #define STACK_BLANK_LEN 4 // in pages
-  int blankaddr = this->Alloc(STACK_BLANK_LEN);
-  DEBUG('a', (char*)"Allocated unmapped virtual area [0x%x,0x%x[ for stack overflow detection\n",
-	blankaddr*g_cfg->PageSize, (blankaddr+STACK_BLANK_LEN)*g_cfg->PageSize);
 
   // The new stack parameters
-  int stackBasePage, numPages;
+  int stackAreaPage, numPages, initPages;
   numPages = divRoundUp(g_cfg->UserStackSize, g_cfg->PageSize);
+#ifdef ETUDIANTS_TP
+  initPages = divRoundUp(g_cfg->UserStackInitSize, g_cfg->PageSize);
+  if (initPages < 1) initPages = 1;
+  if (initPages > numPages) initPages = numPages;
+#else
+  // Without demand paging, the whole stack is allocated now
+  initPages = numPages;
+#endif
 
   // Allocate virtual space for the new stack
-  stackBasePage = this->Alloc(numPages);
-  ASSERT (stackBasePage >= 0);
-  DEBUG('a', (char*)"Allocated virtual area [0x%x,0x%x[ for stack\n",
-	stackBasePage*g_cfg->PageSize,
-	(stackBasePage+numPages)*g_cfg->PageSize);
+  if (!free_stacks.IsEmpty())
+    stackAreaPage = (long)free_stacks.Remove();
+  else
+    stackAreaPage = this->Alloc(STACK_BLANK_LEN + numPages);
+  ASSERT (stackAreaPage >= 0);
+
+  int stackLimitPage = stackAreaPage + STACK_BLANK_LEN;
+  int stackTopPage = stackLimitPage + numPages;
+  int stackBasePage = stackTopPage - initPages;
+  DEBUG('a', (char*)"Allocated unmapped virtual area [0x%x,0x%x[ for stack overflow detection\n",
+	stackAreaPage*g_cfg->PageSize, stackLimitPage*g_cfg->PageSize);
+  DEBUG('a', (char*)"Allocated virtual area [0x%x,0x%x[ for stack, [0x%x,0x%x[ reserved for its growth\n",
+	stackBasePage*g_cfg->PageSize, stackTopPage*g_cfg->PageSize,
+	stackLimitPage*g_cfg->PageSize, stackBasePage*g_cfg->PageSize);
+
+  for (int i = stackAreaPage; i < stackBasePage; i++) {
+    translationTable->clearBitValid(i);
+    translationTable->clearBitSwap(i);
+    translationTable->setAddrDisk(i,-1);
+    translationTable->clearBitIo(i);
+    if (i < stackLimitPage) {
+      translationTable->clearBitReadAllowed(i);
+      translationTable->clearBitWriteAllowed(i);
+    }
+    else {
+      translationTable->setBitReadAllowed(i);
+      translationTable->setBitWriteAllowed(i);
+    }
+  }
 
+  Region *r = new Region(stackBasePage, initPages, REGION_READ|REGION_WRITE,
+			 REGION_STACK);
+  r->stack_limit = stackLimitPage;
+  AddRegion(r);
+
+#ifndef ETUDIANTS_TP
 	for (int i = stackBasePage; i < (stackBasePage + numPages); i++)
 	{
-#ifndef ETUDIANTS_TP
 		/* Without demand paging */
 
 		// Allocate a new physical page for the stack, halt if not page availabke
@@ -303,21 +358,87 @@ int AddrSpace::StackAllocate(void)
 		0x0,g_cfg->PageSize);
 		translationTable->setBitValid(i);
 		/* End of code without demand paging */
+	}
 #endif
-#ifdef ETUDIANTS_TP
-		translationTable->clearBitValid(i);
-#endif
-		translationTable->setAddrDisk(i,-1);
-		translationTable->clearBitSwap(i);
-		translationTable->setBitReadAllowed(i);
-		translationTable->setBitWriteAllowed(i);
-		translationTable->clearBitIo(i);
-    }
 
-  int stackpointer = (stackBasePage+numPages)*g_cfg->PageSize - 4*sizeof(int);
+  int stackpointer = stackTopPage*g_cfg->PageSize - 4*sizeof(int);
   return stackpointer;
 }
 
+//----------------------------------------------------------------------
+/**	Frees the stack of a finished thread: its pages are freed and its
+ *      virtual area can be reused by the next call to StackAllocate
+ *
+ *      \param stackPointer the initial stack pointer of the thread
+ *      (as returned by StackAllocate)
+ */
+//----------------------------------------------------------------------
+void AddrSpace::StackRelease(int stackPointer)
+{
+  Region *r = regions.Find(stackPointer / g_cfg->PageSize);
+  if (r == NULL || r->backing != REGION_STACK)
+    return;
+
+  // Madvise may have split the stack region: free all its parts
+  int stackLimitPage = r->stack_limit;
+  int stackTopPage = r->EndPage();
+  while ((r = regions.FirstOverlap(stackLimitPage, stackTopPage)) != NULL) {
+    ReleasePages(r, r->first_page, r->EndPage());
+    regions.Remove(r);
+    delete r;
+  }
+  ReleasePages(NULL, stackLimitPage, stackTopPage);
+
+  DEBUG('a', (char*)"Released virtual area [0x%x,0x%x[ of stack\n",
+	stackLimitPage*g_cfg->PageSize, stackTopPage*g_cfg->PageSize);
+  free_stacks.Append((void *)(long)(stackLimitPage - STACK_BLANK_LEN));
+}
+
+//----------------------------------------------------------------------
+/**   Grows a stack down to a virtual page, when the page is in the area
+ *    reserved for the growth of the stack. Called on a page fault on a
+ *    page which does not belong to any region.
+ *
+ *    \param virtualPage: the faulting virtual page
+ *    \return the stack region, or NULL if the page is not in the
+ *      area reserved for a stack
+ */
+//----------------------------------------------------------------------
+Region *AddrSpace::GrowStack(int virtualPage)
+{
+  // The stack is the first region above the page
+  Region *r = regions.FirstOverlap(virtualPage, translationTable->getMaxNumPages());
+  if (r == NULL || r->backing != REGION_STACK
+      || virtualPage < r->stack_limit || virtualPage >= r->first_page)
+    return NULL;
+
+  DEBUG('a', (char*)"Stack [0x%x,0x%x[ grows down to 0x%x\n",
+	r->first_page*g_cfg->PageSize, r->EndPage()*g_cfg->PageSize,
+	virtualPage*g_cfg->PageSize);
+
+  // The first page of the region changes, it has to be re-inserted
+  regions.Remove(r);
+  r->nb_pages += r->first_page - virtualPage;
+  r->first_page = virtualPage;
+  regions.Insert(r);
+  return r;
+}
+
+//----------------------------------------------------------------------
+/**   Returns true if a virtual page is in the unmapped area below a
+ *    stack, which means that an access to it is a stack overflow.
+ *
+ *    \param virtualPage: the virtual page
+ */
+//----------------------------------------------------------------------
+bool AddrSpace::IsStackGuard(int virtualPage)
+{
+  Region *r = regions.FirstOverlap(virtualPage, translationTable->getMaxNumPages());
+  return r != NULL && r->backing == REGION_STACK
+    && virtualPage < r->stack_limit
+    && virtualPage >= r->stack_limit - STACK_BLANK_LEN;
+}
+
 //----------------------------------------------------------------------
 /**  Allocate numPages virtual pages in the current address space
 //
@@ -346,6 +467,34 @@ int AddrSpace::Alloc(int numPages)
   return result;
 }
 
+//----------------------------------------------------------------------
+/** Insert a new region in the address space. The access rights of the
+ *  region are copied in the translation table entries of its pages,
+ *  where the MMU checks them; its pages are not in memory yet.
+ *
+ * \param r: the region, which must not overlap an existing region
+ */
+//----------------------------------------------------------------------
+void AddrSpace::AddRegion(Region *r)
+{
+  regions.Insert(r);
+
+  for (int i = r->first_page; i < r->EndPage(); i++) {
+    translationTable->clearBitValid(i);
+    translationTable->clearBitSwap(i);
+    translationTable->setAddrDisk(i,-1);
+    translationTable->clearBitIo(i);
+    if (r->prot & REGION_READ) translationTable->setBitReadAllowed(i);
+    else translationTable->clearBitReadAllowed(i);
+    if (r->prot & REGION_WRITE) translationTable->setBitWriteAllowed(i);
+    else translationTable->clearBitWriteAllowed(i);
+  }
+
+  DEBUG('a', (char*)"Region [0x%x,0x%x[ prot %d backing %d\n",
+	r->first_page*g_cfg->PageSize, r->EndPage()*g_cfg->PageSize,
+	r->prot, r->backing);
+}
+
 //----------------------------------------------------------------------
 /** Map an open file in memory
  *
@@ -357,19 +506,22 @@ int AddrSpace::Alloc(int numPages)
 int AddrSpace::Mmap(OpenFile *f, int size)
 {
 #ifdef ETUDIANTS_TP
-	int nb_pages = size/g_cfg->PageSize + (size % g_cfg->PageSize == 0 ? 0 : 1);
-	int addr = translationTable->getAddrDisk(mapped_files[nb_mapped_files].first_address);
-
-	mapped_files[nb_mapped_files].first_address = (size % g_cfg->PageSize != 0) ? Alloc((size/g_cfg->PageSize)+1) : Alloc(size/g_cfg->PageSize);
-	mapped_files[nb_mapped_files].size = size;
-	mapped_files[nb_mapped_files].file = f;
-	nb_mapped_files++;
-	
-	// Association des adresses disques dans le fichier mapp
-	for(int i = mapped_files[nb_mapped_files].first_address; i < mapped_files[nb_mapped_files].first_address + nb_pages; i++)
-	{
-		//translationTable->setAddrDisk(i, addr + mapped_files[nb_mapped_files].file->Seek(i * g_cfg->PageSize));
-	}
+	if (size <= 0)
+		return -1;
+
+	int nb_pages = divRoundUp(size, g_cfg->PageSize);
+	int first_page = Alloc(nb_pages);
+	if (first_page == -1)
+		return -1;
+
+	// The file is mapped from its beginning, and its modified pages
+	// are written back to it
+	Region *r = new Region(first_page, nb_pages, REGION_READ|REGION_WRITE,
+			       REGION_FILE, f, 0, size);
+	r->shared = true;
+	AddRegion(r);
+
+	return first_page*g_cfg->PageSize;
 #endif
 #ifndef ETUDIANTS_TP
   printf("**** Warning: method AddrSpace::Mmap is not implemented yet\n");
@@ -386,14 +538,10 @@ int AddrSpace::Mmap(OpenFile *f, int size)
 //----------------------------------------------------------------------
 OpenFile *AddrSpace::findMappedFile(int32_t addr) {
 #ifdef ETUDIANTS_TP
-	int i;
-	OpenFile *res = NULL;
-	for(i = 0; i < nb_mapped_files; i++)
-	{
-		if(addr >= mapped_files[i].first_address && addr <= mapped_files[i].first_address+mapped_files[i].size)
-			res = mapped_files[i].file;
-	}
-	return res;
+	Region *r = regions.Find(addr / g_cfg->PageSize);
+	if (r != NULL && r->shared)
+		return r->file;
+	return NULL;
 #endif
 #ifndef ETUDIANTS_TP	
   printf("**** Warning: method AddrSpace::findMappedFile is not implemented yet\n");
@@ -401,6 +549,182 @@ OpenFile *AddrSpace::findMappedFile(int32_t addr) {
 #endif
 }
 
+//----------------------------------------------------------------------
+/*! Check that [addr,addr+size[ is a mapped memory area of this
+ *  address space
+ *
+ * \param addr: first virtual address of the area
+ * \param size: size of the area in bytes
+ * \param first_page: returns the first virtual page of the area
+ * \param nb_pages: returns the number of virtual pages of the area
+ * \return NO_ERROR, or an error number (see msgerror.h)
+ */
+//----------------------------------------------------------------------
+int AddrSpace::CheckArea(int32_t addr, int size, int *first_page, int *nb_pages)
+{
+  if (size <= 0) return INVALID_ARGUMENT;
+  // addr + size may overflow: compare size with the room left instead
+  if (addr < 0 || size > freePageId*g_cfg->PageSize - addr)
+    return INVALID_ADDRESS;
+
+  *first_page = addr / g_cfg->PageSize;
+  *nb_pages = (addr + size - 1) / g_cfg->PageSize - *first_page + 1;
+
+  // The regions overlapping the area must cover it without any hole
+  int page = *first_page;
+  int end = *first_page + *nb_pages;
+  Region *r;
+  while (page < end) {
+    r = regions.Find(page);
+    if (r == NULL) return INVALID_ADDRESS;
+    page = r->EndPage();
+  }
+
+  return NO_ERROR;
+}
+
+//----------------------------------------------------------------------
+/*! Record an access pattern hint for a memory area, and apply the
+ *  hints that call for an immediate action:
+ *  - MADV_WILLNEED loads the pages while free physical pages remain
+ *    (a hint never evicts pages of other areas)
+ *  - MADV_DONTNEED releases the clean pages and makes the dirty ones
+ *    the next victims of the page replacement algorithm
+ *  MADV_SEQUENTIAL, MADV_RANDOM and MADV_NORMAL are recorded in the
+ *  regions of the area (split at its bounds if needed), they are used
+ *  by the page fault manager and the page replacement algorithm.
+ *
+ * \param addr: first virtual address of the area
+ * \param size: size of the area in bytes
+ * \param advice: one of the MADV_* constants of userlib/syscall.h
+ * \return NO_ERROR, or an error number (see msgerror.h)
+ */
+//----------------------------------------------------------------------
+int AddrSpace::Madvise(int32_t addr, int size, int advice)
+{
+  int first_page, nb_pages, i;
+  int err = CheckArea(addr, size, &first_page, &nb_pages);
+  if (err != NO_ERROR) return err;
+
+  switch (advice) {
+  case MADV_NORMAL:
+  case MADV_RANDOM:
+  case MADV_SEQUENTIAL: {
+    // Split the regions at the bounds of the area, so that the hint
+    // applies to whole regions
+    int end = first_page + nb_pages;
+    Region *r = regions.Find(first_page);
+    if (r->first_page < first_page)
+      r = regions.Split(r, first_page);
+    for (; r != NULL; r = regions.FirstOverlap(r->EndPage(), end)) {
+      if (r->EndPage() > end)
+	regions.Split(r, end);
+      r->advice = advice;
+    }
+    break;
+  }
+
+  case MADV_WILLNEED:
+    for (i = first_page; i < first_page + nb_pages; i++) {
+      if (translationTable->getBitValid(i)) continue;
+      if (!g_physical_mem_manager->HasFreePage()) break;
+      g_page_fault_manager->PageFault(i);
+    }
+    break;
+
+  case MADV_DONTNEED:
+    for (i = first_page; i < first_page + nb_pages; i++) {
+      if (!translationTable->getBitValid(i)) continue;
+      int pp = translationTable->getPhysicalPage(i);
+      if (g_physical_mem_manager->tpr[pp].locked) continue;
+      // A clean page can be reloaded from the executable file or
+      // from the swap area, or is still filled with zeroes
+      if (!translationTable->getBitM(i))
+	g_physical_mem_manager->RemovePhysicalToVirtualMapping(pp);
+      else translationTable->clearBitU(i);
+    }
+    break;
+
+  default:
+    return INVALID_ARGUMENT;
+  }
+
+  DEBUG('a', (char*)"Advice %d on virtual pages [%d,%d[\n", advice,
+	first_page, first_page + nb_pages);
+  return NO_ERROR;
+}
+
+//----------------------------------------------------------------------
+/*! Return the access pattern hint in force for a virtual page
+ *
+ * \param virtualPage: the virtual page number
+ * \return one of MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL
+ */
+//----------------------------------------------------------------------
+int AddrSpace::GetAdvice(int virtualPage)
+{
+  Region *r = regions.Find(virtualPage);
+  return (r != NULL) ? r->advice : MADV_NORMAL;
+}
+
+//----------------------------------------------------------------------
+/*! Load the pages of a memory area and lock them in physical memory,
+ *  using the locked flag of the physical page table. At least one
+ *  physical page must remain unlocked for the page replacement
+ *  algorithm.
+ *
+ * \param addr: first virtual address of the area
+ * \param size: size of the area in bytes
+ * \return NO_ERROR, or an error number (see msgerror.h)
+ */
+//----------------------------------------------------------------------
+int AddrSpace::Mlock(int32_t addr, int size)
+{
+  int first_page, nb_pages;
+  int err = CheckArea(addr, size, &first_page, &nb_pages);
+  if (err != NO_ERROR) return err;
+
+  // Pages of the area which are already locked do not count
+  int nb_new = 0;
+  for (int i = first_page; i < first_page + nb_pages; i++)
+    if (!translationTable->getBitValid(i)
+	|| !g_physical_mem_manager->tpr[translationTable->getPhysicalPage(i)].locked)
+      nb_new++;
+  if (g_physical_mem_manager->NumLockedPages() + nb_new
+      >= g_cfg->NumPhysPages)
+    return OUT_OF_MEMORY;
+
+  for (int i = first_page; i < first_page + nb_pages; i++) {
+    if (!translationTable->getBitValid(i))
+      g_page_fault_manager->PageFault(i);
+    g_physical_mem_manager->LockPage(translationTable->getPhysicalPage(i));
+  }
+  return NO_ERROR;
+}
+
+//----------------------------------------------------------------------
+/*! Unlock the pages of a memory area locked by Mlock
+ *
+ * \param addr: first virtual address of the area
+ * \param size: size of the area in bytes
+ * \return NO_ERROR, or an error number (see msgerror.h)
+ */
+//----------------------------------------------------------------------
+int AddrSpace::Munlock(int32_t addr, int size)
+{
+  int first_page, nb_pages;
+  int err = CheckArea(addr, size, &first_page, &nb_pages);
+  if (err != NO_ERROR) return err;
+
+  for (int i = first_page; i < first_page + nb_pages; i++) {
+    if (!translationTable->getBitValid(i)) continue;
+    int pp = translationTable->getPhysicalPage(i);
+    if (g_physical_mem_manager->tpr[pp].locked)
+      g_physical_mem_manager->UnlockPage(pp);
+  }
+  return NO_ERROR;
+}
+
 //----------------------------------------------------------------------
 // SwapELFHeader
 /*! 	Do little endian to big endian conversion on the bytes in the 
@@ -15,6 +15,7 @@
 #include "kernel/copyright.h"
 #include "utility/list.h"
 #include "filesys/openfile.h"
+#include "kernel/region.h"
 
 // Forward references
 class Thread;
@@ -22,15 +23,6 @@ class Semaphore;
 class OpenFile;
 class Process;
 
-#define MAX_MAPPED_FILES 10
-//! Information describing a memory-mapped file
-typedef struct {
-  int32_t first_address;
-  int size; // size in bytes
-  OpenFile *file;
-} s_mapped_file;
-typedef s_mapped_file t_mapped_files[MAX_MAPPED_FILES];
-
 /**
  @brief Defines the data structures to keep track of memory resources of
  executing user programs (address spaces).
@@ -73,15 +65,37 @@ public:
    */ 
   ~AddrSpace();	
 
-  /**	Allocates a new stack of size cfg->UserStackSize
+  /**	Allocates a new stack of initial size cfg->UserStackInitSize,
+   *      which grows on page faults up to cfg->UserStackSize
    *
    *      Allocation is done by calling Alloc, a very simple
-   *      allocation procedure of virtual memory areas.
+   *      allocation procedure of virtual memory areas, or by reusing
+   *      the stack of a finished thread.
    *
    *      \return stack pointer (at the end of the allocated stack)
    */
   int StackAllocate();                  
 
+  /**	Frees the stack of a finished thread, so that it can be reused
+   *
+   *      \param stackPointer the initial stack pointer of the thread
+   *      (as returned by StackAllocate)
+   */
+  void StackRelease(int stackPointer);
+
+  /**   Grows a stack down to a virtual page, if the page is in the
+   *      area reserved for the growth of a stack
+   *
+   *      \return the stack region, or NULL if the page is not in the
+   *      area reserved for a stack
+   */
+  Region *GrowStack(int virtualPage);
+
+  /**   Returns true if a virtual page is in the guard area below a
+   *      stack (i.e. an access to it is a stack overflow)
+   */
+  bool IsStackGuard(int virtualPage);
+
   /** Returns the address of the first instruction to execute in the process
     found in the ELF file */
   int32_t getCodeStartAddress()
@@ -96,9 +110,15 @@ public:
    *
    * \param f: pointer to open file descriptor
    * \param size: size to be mapped (rounded up to next page boundary)
+   * \return the virtual address at which the file is mapped, or -1
    */
   int Mmap(OpenFile *f, int size);
 
+  /*! Return the region containing a virtual page, or NULL if the
+   * page is not mapped
+   */
+  Region *FindRegion(int virtualPage) { return regions.Find(virtualPage); }
+
   /*! Search if the address is in a memory-mapped file
    *
    * \param addr: virtual address to be searched for
@@ -106,7 +126,48 @@ public:
    */
   OpenFile *findMappedFile(int32_t addr);
 
+  /*! Record an access pattern hint for a memory area and apply it
+   *
+   * \param addr: first virtual address of the area
+   * \param size: size of the area in bytes
+   * \param advice: one of the MADV_* constants of userlib/syscall.h
+   * \return NO_ERROR, or an error number (see msgerror.h)
+   */
+  int Madvise(int32_t addr, int size, int advice);
+
+  /*! Return the access pattern hint in force for a virtual page
+   * (MADV_NORMAL when no hint was given or the page is not mapped)
+   */
+  int GetAdvice(int virtualPage);
+
+  /*! Load the pages of a memory area and lock them in physical memory
+   *
+   * \return NO_ERROR, or an error number (see msgerror.h)
+   */
+  int Mlock(int32_t addr, int size);
+
+  /*! Unlock the pages of a memory area locked by Mlock
+   *
+   * \return NO_ERROR, or an error number (see msgerror.h)
+   */
+  int Munlock(int32_t addr, int size);
+
 private:
+  /*! Check that [addr,addr+size[ is a mapped memory area and return
+   * its first virtual page and number of pages
+   */
+  int CheckArea(int32_t addr, int size, int *first_page, int *nb_pages);
+
+  /*! Insert a new region in the address space, and set the access
+   * rights of its pages in the translation table
+   */
+  void AddRegion(Region *r);
+
+  /*! Free the physical pages and swap sectors of the virtual pages
+   * [first_page,end_page[ of a region, and make them unaccessible
+   */
+  void ReleasePages(Region *r, int first_page, int end_page);
+
   //* Code start address, found in the ELF file
   int32_t CodeStartAddress; 
 
@@ -128,9 +189,12 @@ private:
   /*! (Heavyweight) process using this address space */
   Process *process;
 
-  /*! List of memory-mapped files */
-  int nb_mapped_files;
-  t_mapped_files mapped_files;
+  /*! Regions (code, data, stacks, memory-mapped files, ...) */
+  RegionTree regions;
+
+  /*! Virtual areas of the stacks of finished threads, available for
+    new threads (first virtual page of each area) */
+  Listint free_stacks;
 };
 
 #endif // ADDRSPACE_H
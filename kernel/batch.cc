@@ -0,0 +1,267 @@
+/*! \file  batch.cc
+//  \brief Run a batch of independent Nachos machines in parallel
+//
+//  Usage: nachos -b <batchfile> [-j <workers>] [-f <configfile>]
+//
+//  Each line of the batch file gives the command line arguments of
+//  one job (for instance "-f test.cfg -x /hello"). Empty lines and
+//  lines starting with '#' are ignored.
+//
+//  The kernel state is global, so each job runs a complete Nachos
+//  machine in its own host process, which keeps the jobs isolated.
+//  At most <workers> jobs run at the same time (one per host processor
+//  by default). Job number n uses its own disk files
+//  (<batchfile>.n.disk and <batchfile>.n.disk.swap), initialized with
+//  a copy of the disk of <configfile> (DiskFile option). The jobs get
+//  the -job option, so that they neither format their disk nor copy
+//  the files: the disk must be initialized (by a run of nachos with
+//  <configfile>) before the batch is run. The output of a job goes
+//  to <batchfile>.n.log, and a report of all the jobs is printed at
+//  the end.
+*/
+// Copyright (c) 1999-2000 INSA de Rennes.
+// All rights reserved.
+// See copyright_insa.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "kernel/system.h"
+#include "utility/utility.h"
+#include "utility/config.h"
+
+#define MAX_BATCH_ARGS 64
+
+//! A job of the batch
+struct BatchJob {
+  char line[MAXSTRLEN];       //!< Arguments of the job, as in the batch file
+  char disk[MAXSTRLEN];       //!< UNIX file simulating the disk of the job
+  char log[MAXSTRLEN];        //!< Output of the job
+  pid_t pid;                  //!< Host process running the job
+  int status;                 //!< Exit status of the job
+  unsigned long long cycles;  //!< Simulated time, read from the statistics
+  double seconds;             //!< Host time
+  struct timeval start;       //!< Host date when the job started
+};
+
+//----------------------------------------------------------------------
+// CopyUnixFile
+/*! Copy a UNIX file, if it exists
+//
+// \param from source file
+// \param to destination file
+*/
+//----------------------------------------------------------------------
+static void
+CopyUnixFile(char *from, char *to)
+{
+  char buffer[4096];
+  int in = open(from, O_RDONLY);
+  if (in < 0) return;
+  int out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (out >= 0) {
+    int len;
+    while ((len = read(in, buffer, sizeof(buffer))) > 0)
+      if (write(out, buffer, len) != len) break;
+    close(out);
+  }
+  close(in);
+}
+
+//----------------------------------------------------------------------
+// StartJob
+/*! Start a job in a new host process, which runs the nachos binary
+//  with the arguments of the job and its own disk files.
+//
+// \param job the job
+// \param nachos path of the nachos binary, as given on the command
+//        line (used when /proc/self/exe is not available)
+// \param template_disk disk copied to the disk of the job
+*/
+//----------------------------------------------------------------------
+static void
+StartJob(BatchJob *job, char *nachos, char *template_disk)
+{
+  char args[MAXSTRLEN];
+  char *argv[MAX_BATCH_ARGS + 5];
+  int argc = 0;
+
+  strcpy(args, job->line);
+  argv[argc++] = nachos;
+  for (char *tok = strtok(args, " \t"); tok != NULL && argc < MAX_BATCH_ARGS;
+       tok = strtok(NULL, " \t"))
+    argv[argc++] = tok;
+  argv[argc++] = (char*)"-disk";
+  argv[argc++] = job->disk;
+  argv[argc++] = (char*)"-job";
+  argv[argc] = NULL;
+
+  gettimeofday(&job->start, NULL);
+  fflush(stdout);
+  job->pid = fork();
+  if (job->pid < 0) {
+    perror("fork");
+    job->status = -1;
+    return;
+  }
+  if (job->pid == 0) {
+    CopyUnixFile(template_disk, job->disk);
+    int fd = open(job->log, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd >= 0) {
+      dup2(fd, 1);
+      dup2(fd, 2);
+      close(fd);
+    }
+    // argv[0] may have been found through the PATH
+    execv("/proc/self/exe", argv);
+    execvp(nachos, argv);
+    perror(nachos);
+    _exit(127);
+  }
+}
+
+//----------------------------------------------------------------------
+// EndJob
+/*! Collect the results of a job which terminated: exit status, host
+//  time, and simulated time read in its output. Its disk files are
+//  removed.
+//
+// \param job the job
+// \param status status returned by waitpid
+*/
+//----------------------------------------------------------------------
+static void
+EndJob(BatchJob *job, int status)
+{
+  struct timeval end;
+  gettimeofday(&end, NULL);
+  job->seconds = (end.tv_sec - job->start.tv_sec)
+    + (end.tv_usec - job->start.tv_usec) / 1e6;
+  job->status = WIFEXITED(status) ? (signed char)WEXITSTATUS(status) : -1;
+
+  FILE *log = fopen(job->log, "r");
+  if (log != NULL) {
+    char line[MAXSTRLEN];
+    while (fgets(line, sizeof(line), log) != NULL)
+      sscanf(line, " Total time : %llu", &job->cycles);
+    fclose(log);
+  }
+
+  char swap[MAXSTRLEN + 8];
+  sprintf(swap, "%s.swap", job->disk);
+  unlink(job->disk);
+  unlink(swap);
+}
+
+//----------------------------------------------------------------------
+// RunBatch
+/*! Run the jobs of a batch file on a pool of host processes, and
+//  print a report.
+//
+// \param batchfile the batch file
+// \param nb_workers maximum number of jobs running at the same time
+//        (0: one per host processor)
+// \param nachos path of the nachos binary
+// \param configfile configuration file giving the disk copied to the
+//        disk of each job
+// \return 0 if all the jobs succeeded, -1 otherwise
+*/
+//----------------------------------------------------------------------
+int
+RunBatch(char *batchfile, int nb_workers, char *nachos, char *configfile)
+{
+  // The config is read here, before Initialize
+  Config *cfg = new Config(configfile);
+  char template_disk[MAXSTRLEN];
+  strcpy(template_disk, cfg->DiskFileName);
+  delete cfg;
+  if (access(template_disk, R_OK) != 0) {
+    perror(template_disk);
+    return -1;
+  }
+
+  FILE *batch = fopen(batchfile, "r");
+  if (batch == NULL) {
+    perror(batchfile);
+    return -1;
+  }
+
+  // Read the jobs
+  int nb_jobs = 0, size = 16;
+  BatchJob *jobs = (BatchJob *)malloc(size * sizeof(BatchJob));
+  char line[MAXSTRLEN];
+  while (fgets(line, sizeof(line), batch) != NULL) {
+    line[strcspn(line, "\r\n")] = '\0';
+    char *start = line + strspn(line, " \t");
+    if (*start == '\0' || *start == '#')
+      continue;
+    if (nb_jobs == size) {
+      size *= 2;
+      jobs = (BatchJob *)realloc(jobs, size * sizeof(BatchJob));
+    }
+    BatchJob *job = &jobs[nb_jobs];
+    memset(job, 0, sizeof(BatchJob));
+    strncpy(job->line, start, MAXSTRLEN - 1);
+    sprintf(job->disk, "%s.%d.disk", batchfile, nb_jobs);
+    sprintf(job->log, "%s.%d.log", batchfile, nb_jobs);
+    nb_jobs++;
+  }
+  fclose(batch);
+
+  if (nb_workers <= 0)
+    nb_workers = sysconf(_SC_NPROCESSORS_ONLN);
+  if (nb_workers <= 0)
+    nb_workers = 1;
+
+  // Run them, at most nb_workers at a time
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  int next = 0, running = 0;
+  while (next < nb_jobs || running > 0) {
+    if (next < nb_jobs && running < nb_workers) {
+      StartJob(&jobs[next], nachos, template_disk);
+      if (jobs[next].pid > 0) running++;
+      next++;
+      continue;
+    }
+    int status;
+    pid_t pid = wait(&status);
+    if (pid < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    for (int i = 0; i < next; i++)
+      if (jobs[i].pid == pid) {
+	EndJob(&jobs[i], status);
+	running--;
+	break;
+      }
+  }
+  gettimeofday(&end, NULL);
+
+  // Report
+  int nb_failed = 0;
+  unsigned long long total_cycles = 0;
+  double total_seconds = 0;
+  printf("Batch %s: %d jobs on %d workers\n", batchfile, nb_jobs, nb_workers);
+  printf("  job status       cycles  host time  arguments\n");
+  for (int i = 0; i < nb_jobs; i++) {
+    if (jobs[i].status != 0) nb_failed++;
+    total_cycles += jobs[i].cycles;
+    total_seconds += jobs[i].seconds;
+    printf("%5d %6d %12llu %9.3fs  %s\n", i, jobs[i].status,
+	   jobs[i].cycles, jobs[i].seconds, jobs[i].line);
+  }
+  double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+  printf("%d jobs, %d failed, %llu simulated cycles, %.3fs of host time in %.3fs (speedup %.2f)\n",
+	 nb_jobs, nb_failed, total_cycles, total_seconds, elapsed,
+	 elapsed > 0 ? total_seconds / elapsed : 0.0);
+
+  free(jobs);
+  return nb_failed == 0 ? 0 : -1;
+}
@@ -24,10 +24,13 @@
 #include "kernel/system.h"
 #include "userlib/syscall.h"
 #include "kernel/synch.h"
+#include "kernel/pipe.h"
+#include "kernel/scheduler.h"
 #include "drivers/drvACIA.h"
 #include "drivers/drvConsole.h"
 #include "filesys/oftable.h"
 #include "vm/pagefaultmanager.h"
+#include "vm/physMem.h"
 #include "utility/objid.h"
 
 //----------------------------------------------------------------------
@@ -73,6 +76,68 @@ static void GetStringParam(int addr,char *dest,int maxlen) {
   dest[maxlen-1]='\0';
 }
 
+#ifdef ETUDIANTS_TP
+//----------------------------------------------------------------------
+// GetThreadParam
+/*!	Returns the thread designated by a thread identifier given to a
+//	system call
+//
+//	\param tid is the thread identifier, 0 for the calling thread
+//	\return the thread, or NULL if there is no such thread (or it has
+//	finished)
+*/
+//----------------------------------------------------------------------
+static Thread *GetThreadParam(int32_t tid) {
+  if (tid == 0)
+    return g_current_thread;
+  // The id of a thread is removed when it finishes (see Thread::Finish)
+  Thread *t = (Thread *)g_object_ids->SearchObject(tid);
+  if (t == NULL || t->type != THREAD_TYPE)
+    return NULL;
+  return t;
+}
+
+//----------------------------------------------------------------------
+// AlarmExpired
+/*!	Kernel timer of the Alarm system call: V on the semaphore, if it
+//	was not destroyed in the meantime
+//
+//	\param sid is the semaphore identifier
+*/
+//----------------------------------------------------------------------
+static void AlarmExpired(int64_t sid) {
+  Semaphore *sema = (Semaphore *)g_object_ids->SearchObject((int32_t)sid);
+  if (sema && sema->type == SEMAPHORE_TYPE)
+    sema->V();
+}
+
+//! Period of the polling of the serial line by Select, in cycles,
+//! when the ACIA driver does not use interrupts
+#define SELECT_POLL_PERIOD 1000
+
+//----------------------------------------------------------------------
+// SelectType
+/*!	Type of an object which Select can wait for
+//
+//	\param id is the object identifier
+//	\return SEMAPHORE_TYPE, PIPE_TYPE or MSGQUEUE_TYPE, or
+//	INVALID_TYPE if there is no such object (or of another type)
+*/
+//----------------------------------------------------------------------
+static ObjectType SelectType(int32_t id) {
+  void *obj = g_object_ids->SearchObject(id);
+  if (obj == NULL)
+    return INVALID_TYPE;
+  if (((Semaphore *)obj)->type == SEMAPHORE_TYPE)
+    return SEMAPHORE_TYPE;
+  if (((Pipe *)obj)->type == PIPE_TYPE)
+    return PIPE_TYPE;
+  if (((MsgQueue *)obj)->type == MSGQUEUE_TYPE)
+    return MSGQUEUE_TYPE;
+  return INVALID_TYPE;
+}
+#endif
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 /*!   Entry point into the Nachos kernel.  Called when a user program
@@ -163,6 +228,8 @@ void ExceptionHandler(ExceptionType exceptiontype, int vaddr)
           char ch[size];
           GetStringParam(addr,ch,size);
           sprintf(name,"master thread of process %s",ch);
+          // Do not start a new process while memory is overcommitted
+          g_physical_mem_manager->WaitForAdmission();
           Process * p = new Process(ch, &error);
           if (error != NO_ERROR) {
             g_machine->WriteIntRegister(2,ERROR);
@@ -172,8 +239,13 @@ void ExceptionHandler(ExceptionType exceptiontype, int vaddr)
             g_syscall_error->SetMsg(ch,error);
             break;
           }
+          #ifdef ETUDIANTS_TP
+          // A new process gets the nice value of its creator
+          p->SetNice(g_current_thread->GetProcessOwner()->nice);
+          #endif
           Thread *ptThread = new Thread(name);
           int32_t tid = g_object_ids->AddObject(ptThread);
+          ptThread->SetId(tid);
           error = ptThread->Start(p,
           p->addrspace->getCodeStartAddress(),
           -1);
@@ -210,10 +282,13 @@ void ExceptionHandler(ExceptionType exceptiontype, int vaddr)
           char thr_name[size];
           GetStringParam(name_addr, thr_name, size);
           //char *proc_name = g_current_thread->getProcessOwner()->getName();
+          // Do not start a new thread while memory is overcommitted
+          g_physical_mem_manager->WaitForAdmission();
           // Finally start it
           ptThread = new Thread(thr_name);
           int32_t tid;
           tid = g_object_ids->AddObject(ptThread);
+          ptThread->SetId(tid);
           err = ptThread->Start(g_current_thread->GetProcessOwner(),
           fun, arg);
           if (err != NO_ERROR) {
@@ -235,10 +310,11 @@ void ExceptionHandler(ExceptionType exceptiontype, int vaddr)
           Thread* ptThread;
           tid = g_machine->ReadIntRegister(4);
           ptThread = (Thread *)g_object_ids->SearchObject(tid);
-          if (ptThread
-            && ptThread->type == THREAD_TYPE)
+          // The id of a thread is removed when it finishes, so that
+          // it cannot designate another thread later
+          if (ptThread && ptThread->type == THREAD_TYPE)
             {
-              g_current_thread->Join(ptThread);
+              g_current_thread->Join(tid);
               g_syscall_error->SetMsg((char*)"",NO_ERROR);
               g_machine->WriteIntRegister(2,0);
             }
@@ -262,6 +338,27 @@ void ExceptionHandler(ExceptionType exceptiontype, int vaddr)
           break;
         }
 
+        case SC_YIELD_TO: {
+          DEBUG('e', (char*)"Process or thread: YieldTo call.\n");
+          int32_t tid = g_machine->ReadIntRegister(4);
+          Thread *t = GetThreadParam(tid);
+          if (t == NULL) {
+            g_machine->WriteIntRegister(2,ERROR);
+            sprintf(msg,"%d",tid);
+            g_syscall_error->SetMsg(msg,INVALID_THREAD_ID);
+            break;
+          }
+          // Not ready: behave like Yield
+          if (g_current_thread->YieldTo(t))
+            g_machine->WriteIntRegister(2,0);
+          else {
+            g_current_thread->Yield();
+            g_machine->WriteIntRegister(2,1);
+          }
+          g_syscall_error->SetMsg((char*)"",NO_ERROR);
+          break;
+        }
+
         case SC_PERROR: {
           // the PError system call
           // print the last error message
@@ -690,9 +787,24 @@ void ExceptionHandler(ExceptionType exceptiontype, int vaddr)
             DEBUG('e', (char*)"Condition: Wait call.\n");
             // Get the cond ID
             int32_t cid = g_machine -> ReadIntRegister(4);
+            // Get the lock ID (0: no lock)
+            int32_t lid = g_machine -> ReadIntRegister(5);
             Condition *cond = (Condition *)g_object_ids -> SearchObject(cid);
-            if (cond && cond -> type == CONDITION_TYPE) {
-              cond -> Wait();
+            Lock *lock = (lid == 0) ? NULL : (Lock *)g_object_ids -> SearchObject(lid);
+            if (cond && cond -> type == CONDITION_TYPE
+                && lid != 0 && (lock == NULL || lock -> type != LOCK_TYPE
+                                || !lock -> isHeldByCurrentThread()
+                                || !cond -> CanWaitWith(lock))) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",lid);
+              g_syscall_error -> SetMsg(msg,INVALID_LOCK_ID);
+            } else if (cond && cond -> type == CONDITION_TYPE
+                       && !cond -> CanWaitWith(lock)) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",cid);
+              g_syscall_error -> SetMsg(msg,INVALID_CONDITION_ID);
+            } else if (cond && cond -> type == CONDITION_TYPE) {
+              cond -> Wait(lock);
               g_machine -> WriteIntRegister(2,0);
               g_syscall_error -> SetMsg((char*)"",NO_ERROR);
             } else {
@@ -737,6 +849,359 @@ void ExceptionHandler(ExceptionType exceptiontype, int vaddr)
             break;
           }
 
+          case SC_RWLOCK_CREATE: {
+            DEBUG('e', (char*)"RWLock: Create call.\n");
+            // get the debug name and the policy
+            int32_t addr = g_machine->ReadIntRegister(4);
+            bool writer_preference = (g_machine->ReadIntRegister(5) != 0);
+            int size = GetLengthParam(addr);
+            char debugName[size];
+            GetStringParam(addr,debugName,size);
+            RWLock *rwlock = new RWLock(debugName,writer_preference);
+            int32_t rid = g_object_ids -> AddObject(rwlock);
+            g_machine -> WriteIntRegister(2,rid);
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
+          case SC_RWLOCK_DESTROY: {
+            DEBUG('e', (char*)"RWLock: Destroy call.\n");
+            // Get the lock ID
+            int32_t rid = g_machine -> ReadIntRegister(4);
+            RWLock *rwlock = (RWLock *)g_object_ids -> SearchObject(rid);
+            if (rwlock && rwlock -> type == RWLOCK_TYPE) {
+              delete rwlock;
+              g_object_ids -> RemoveObject(rid);
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",rid);
+              g_syscall_error -> SetMsg(msg,INVALID_RWLOCK_ID);
+            }
+            break;
+          }
+
+          case SC_RWLOCK_READ: {
+            DEBUG('e', (char*)"RWLock: Read call.\n");
+            // Get the lock ID
+            int32_t rid = g_machine -> ReadIntRegister(4);
+            RWLock *rwlock = (RWLock *)g_object_ids -> SearchObject(rid);
+            if (rwlock && rwlock -> type == RWLOCK_TYPE) {
+              rwlock -> AcquireRead();
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",rid);
+              g_syscall_error -> SetMsg(msg,INVALID_RWLOCK_ID);
+            }
+            break;
+          }
+
+          case SC_RWLOCK_WRITE: {
+            DEBUG('e', (char*)"RWLock: Write call.\n");
+            // Get the lock ID
+            int32_t rid = g_machine -> ReadIntRegister(4);
+            RWLock *rwlock = (RWLock *)g_object_ids -> SearchObject(rid);
+            if (rwlock && rwlock -> type == RWLOCK_TYPE) {
+              rwlock -> AcquireWrite();
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",rid);
+              g_syscall_error -> SetMsg(msg,INVALID_RWLOCK_ID);
+            }
+            break;
+          }
+
+          case SC_RWLOCK_RELEASE: {
+            DEBUG('e', (char*)"RWLock: Release call.\n");
+            // Get the lock ID
+            int32_t rid = g_machine -> ReadIntRegister(4);
+            RWLock *rwlock = (RWLock *)g_object_ids -> SearchObject(rid);
+            if (rwlock && rwlock -> type == RWLOCK_TYPE && rwlock -> isHeldByCurrentThread()) {
+              rwlock -> Release();
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",rid);
+              g_syscall_error -> SetMsg(msg,INVALID_RWLOCK_ID);
+            }
+            break;
+          }
+
+          case SC_BARRIER_CREATE: {
+            DEBUG('e', (char*)"Barrier: Create call.\n");
+            // get the debug name and the number of parties
+            int32_t addr = g_machine->ReadIntRegister(4);
+            int nb_parties = g_machine->ReadIntRegister(5);
+            int size = GetLengthParam(addr);
+            char debugName[size];
+            GetStringParam(addr,debugName,size);
+            if (nb_parties <= 0) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",nb_parties);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+              break;
+            }
+            Barrier *barrier = new Barrier(debugName,nb_parties);
+            int32_t bid = g_object_ids -> AddObject(barrier);
+            g_machine -> WriteIntRegister(2,bid);
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
+          case SC_BARRIER_DESTROY: {
+            DEBUG('e', (char*)"Barrier: Destroy call.\n");
+            int32_t bid = g_machine -> ReadIntRegister(4);
+            Barrier *barrier = (Barrier *)g_object_ids -> SearchObject(bid);
+            if (barrier && barrier -> type == BARRIER_TYPE) {
+              delete barrier;
+              g_object_ids -> RemoveObject(bid);
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",bid);
+              g_syscall_error -> SetMsg(msg,INVALID_BARRIER_ID);
+            }
+            break;
+          }
+
+          case SC_BARRIER_WAIT: {
+            DEBUG('e', (char*)"Barrier: Wait call.\n");
+            int32_t bid = g_machine -> ReadIntRegister(4);
+            Barrier *barrier = (Barrier *)g_object_ids -> SearchObject(bid);
+            if (barrier && barrier -> type == BARRIER_TYPE) {
+              g_machine -> WriteIntRegister(2,barrier -> Wait() ? 1 : 0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",bid);
+              g_syscall_error -> SetMsg(msg,INVALID_BARRIER_ID);
+            }
+            break;
+          }
+
+          case SC_PIPE_CREATE: {
+            DEBUG('e', (char*)"Pipe: Create call.\n");
+            // get the debug name
+            int32_t addr = g_machine->ReadIntRegister(4);
+            int size = GetLengthParam(addr);
+            char debugName[size];
+            GetStringParam(addr,debugName,size);
+            Pipe *pipe = new Pipe(debugName);
+            g_machine -> WriteIntRegister(2,g_object_ids -> AddObject(pipe));
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
+          case SC_PIPE_DESTROY: {
+            DEBUG('e', (char*)"Pipe: Destroy call.\n");
+            int32_t id = g_machine -> ReadIntRegister(4);
+            Pipe *pipe = (Pipe *)g_object_ids -> SearchObject(id);
+            if (pipe && pipe -> type == PIPE_TYPE) {
+              delete pipe;
+              g_object_ids -> RemoveObject(id);
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",id);
+              g_syscall_error -> SetMsg(msg,INVALID_PIPE_ID);
+            }
+            break;
+          }
+
+          case SC_PIPE_WRITE:
+          case SC_PIPE_GIFT:
+          case SC_PIPE_READ: {
+            DEBUG('e', (char*)"Pipe: %s call.\n", type == SC_PIPE_READ ? "Read" : "Write");
+            int32_t id = g_machine -> ReadIntRegister(4);
+            int32_t addr = g_machine -> ReadIntRegister(5);
+            int size = g_machine -> ReadIntRegister(6);
+            Pipe *pipe = (Pipe *)g_object_ids -> SearchObject(id);
+            if (!pipe || pipe -> type != PIPE_TYPE) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",id);
+              g_syscall_error -> SetMsg(msg,INVALID_PIPE_ID);
+            } else if (size < 0) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",size);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+            } else {
+              int n = (type == SC_PIPE_READ) ? pipe -> Read(addr,size)
+                : pipe -> Write(addr,size,type == SC_PIPE_GIFT);
+              g_machine -> WriteIntRegister(2,n);
+              if (n < 0) {
+                sprintf(msg,"%d (closed)",id);
+                g_syscall_error -> SetMsg(msg,INVALID_PIPE_ID);
+              } else
+                g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            }
+            break;
+          }
+
+          case SC_PIPE_CLOSE: {
+            DEBUG('e', (char*)"Pipe: Close call.\n");
+            int32_t id = g_machine -> ReadIntRegister(4);
+            Pipe *pipe = (Pipe *)g_object_ids -> SearchObject(id);
+            if (pipe && pipe -> type == PIPE_TYPE) {
+              pipe -> Close();
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",id);
+              g_syscall_error -> SetMsg(msg,INVALID_PIPE_ID);
+            }
+            break;
+          }
+
+          case SC_MSGQ_CREATE: {
+            DEBUG('e', (char*)"MsgQueue: Create call.\n");
+            // get the debug name and the limits of the queue
+            int32_t addr = g_machine->ReadIntRegister(4);
+            int max_msgs = g_machine->ReadIntRegister(5);
+            int max_size = g_machine->ReadIntRegister(6);
+            int size = GetLengthParam(addr);
+            char debugName[size];
+            GetStringParam(addr,debugName,size);
+            if (!MsgQueue::ValidLimits(max_msgs,max_size)) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d messages of %d bytes",max_msgs,max_size);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+              break;
+            }
+            MsgQueue *queue = new MsgQueue(debugName,max_msgs,max_size);
+            g_machine -> WriteIntRegister(2,g_object_ids -> AddObject(queue));
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
+          case SC_MSGQ_DESTROY: {
+            DEBUG('e', (char*)"MsgQueue: Destroy call.\n");
+            int32_t id = g_machine -> ReadIntRegister(4);
+            MsgQueue *queue = (MsgQueue *)g_object_ids -> SearchObject(id);
+            if (queue && queue -> type == MSGQUEUE_TYPE) {
+              delete queue;
+              g_object_ids -> RemoveObject(id);
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",id);
+              g_syscall_error -> SetMsg(msg,INVALID_MSGQUEUE_ID);
+            }
+            break;
+          }
+
+          case SC_MSGQ_SEND:
+          case SC_MSGQ_GIFT:
+          case SC_MSGQ_RECEIVE: {
+            DEBUG('e', (char*)"MsgQueue: %s call.\n", type == SC_MSGQ_RECEIVE ? "Receive" : "Send");
+            int32_t id = g_machine -> ReadIntRegister(4);
+            int32_t addr = g_machine -> ReadIntRegister(5);
+            int size = g_machine -> ReadIntRegister(6);
+            MsgQueue *queue = (MsgQueue *)g_object_ids -> SearchObject(id);
+            if (!queue || queue -> type != MSGQUEUE_TYPE) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",id);
+              g_syscall_error -> SetMsg(msg,INVALID_MSGQUEUE_ID);
+            } else if (size < 0 || (type != SC_MSGQ_RECEIVE && size > queue -> getMaxSize())) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",size);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+            } else if (type != SC_MSGQ_RECEIVE) {
+              queue -> Send(addr,size,type == SC_MSGQ_GIFT);
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,queue -> Receive(addr,size));
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            }
+            break;
+          }
+
+          case SC_SELECT: {
+            DEBUG('e', (char*)"Select call.\n");
+            int32_t ids_addr = g_machine -> ReadIntRegister(4);
+            int32_t ready_addr = g_machine -> ReadIntRegister(5);
+            int nb = g_machine -> ReadIntRegister(6);
+            int timeout = g_machine -> ReadIntRegister(7);
+            if (nb < 0 || nb > SELECT_MAX || timeout < -1) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",nb);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+              break;
+            }
+            int ids[SELECT_MAX];
+            int ready[SELECT_MAX];
+            int i;
+            uint32_t v;
+            bool console = false, tty = false;
+            for (i = 0; i < nb; i++) {
+              g_machine -> mmu -> ReadMem(ids_addr + 4*i,4,&v,false);
+              ids[i] = (int)v;
+              if (ids[i] == CONSOLE_INPUT) console = true;
+              else if (ids[i] == TTY_INPUT && g_acia_driver != NULL) tty = true;
+              else if (SelectType(ids[i]) == INVALID_TYPE) break;
+            }
+            if (i < nb) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",ids[i]);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+              break;
+            }
+
+            // The console reports typed characters only when its
+            // interrupts are enabled. The ACIA does not wake up the
+            // threads in the Busy Waiting mode: poll it regularly.
+            if (console) g_console_driver -> StartPolling();
+            bool poll_tty = tty && g_cfg -> ACIA != ACIA_INTERRUPT;
+            Time deadline = timeout > 0 ? g_stats -> getTotalTicks() + timeout : 0;
+            int nb_ready;
+            IntStatus old_status = g_machine -> interrupt -> GetStatus();
+            g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
+            while (true) {
+              nb_ready = 0;
+              for (i = 0; i < nb; i++) {
+                if (ids[i] == CONSOLE_INPUT)
+                  ready[i] = g_console_driver -> CharAvailable();
+                else if (ids[i] == TTY_INPUT && tty)
+                  ready[i] = g_acia_driver -> CanReceive();
+                else {
+                  void *obj = g_object_ids -> SearchObject(ids[i]);
+                  switch (SelectType(ids[i])) {
+                  case SEMAPHORE_TYPE: ready[i] = ((Semaphore *)obj) -> IsAvailable(); break;
+                  case PIPE_TYPE: ready[i] = ((Pipe *)obj) -> IsReadable(); break;
+                  case MSGQUEUE_TYPE: ready[i] = ((MsgQueue *)obj) -> IsReadable(); break;
+                  default: ready[i] = 1; // destroyed meanwhile
+                  }
+                }
+                nb_ready += ready[i];
+              }
+              Time now = g_stats -> getTotalTicks();
+              if (nb_ready > 0 || timeout == 0 || (deadline != 0 && now >= deadline))
+                break;
+              Time wake = deadline;
+              if (poll_tty && (wake == 0 || wake > now + SELECT_POLL_PERIOD))
+                wake = now + SELECT_POLL_PERIOD;
+              WaitEvent(wake);
+            }
+            g_machine -> interrupt -> SetStatus(old_status);
+            if (console) g_console_driver -> StopPolling();
+
+            for (i = 0; i < nb; i++)
+              g_machine -> mmu -> WriteMem(ready_addr + 4*i,4,ready[i]);
+            g_machine -> WriteIntRegister(2,nb_ready);
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
           case SC_MMAP: {
             DEBUG('e', (char*)"MMAP call.\n");
             int f;
@@ -749,12 +1214,234 @@ void ExceptionHandler(ExceptionType exceptiontype, int vaddr)
             {
               ret = g_current_thread->GetProcessOwner()->addrspace->Mmap(file,size);
               g_machine->WriteIntRegister(2,ret);
-              g_syscall_error->SetMsg((char*)"",NO_ERROR);
+              if (ret == -1)
+              {
+                sprintf(msg,"%d",size);
+                g_syscall_error->SetMsg(msg,OUT_OF_MEMORY);
+              }
+              else g_syscall_error->SetMsg((char*)"",NO_ERROR);
             }
             else
             {
-              g_syscall_error->SetMsg((char*)"",INVALID_FILE_ID);
+              g_machine->WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",f);
+              g_syscall_error->SetMsg(msg,INVALID_FILE_ID);
+            }
+            break;
+          }
+
+          case SC_MADVISE: {
+            DEBUG('e', (char*)"Memory: Madvise call.\n");
+            int32_t addr = g_machine -> ReadIntRegister(4);
+            int size = g_machine -> ReadIntRegister(5);
+            int advice = g_machine -> ReadIntRegister(6);
+            int err = g_current_thread -> GetProcessOwner() -> addrspace -> Madvise(addr,size,advice);
+            if (err == NO_ERROR) {
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"0x%x",addr);
+              g_syscall_error -> SetMsg(msg,err);
+            }
+            break;
+          }
+
+          case SC_MLOCK: {
+            DEBUG('e', (char*)"Memory: Mlock call.\n");
+            int32_t addr = g_machine -> ReadIntRegister(4);
+            int size = g_machine -> ReadIntRegister(5);
+            int err = g_current_thread -> GetProcessOwner() -> addrspace -> Mlock(addr,size);
+            if (err == NO_ERROR) {
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"0x%x",addr);
+              g_syscall_error -> SetMsg(msg,err);
             }
+            break;
+          }
+
+          case SC_MUNLOCK: {
+            DEBUG('e', (char*)"Memory: Munlock call.\n");
+            int32_t addr = g_machine -> ReadIntRegister(4);
+            int size = g_machine -> ReadIntRegister(5);
+            int err = g_current_thread -> GetProcessOwner() -> addrspace -> Munlock(addr,size);
+            if (err == NO_ERROR) {
+              g_machine -> WriteIntRegister(2,0);
+              g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            } else {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"0x%x",addr);
+              g_syscall_error -> SetMsg(msg,err);
+            }
+            break;
+          }
+
+          case SC_SET_PRIORITY: {
+            DEBUG('e', (char*)"Scheduler: SetPriority call.\n");
+            int32_t tid = g_machine -> ReadIntRegister(4);
+            int priority = g_machine -> ReadIntRegister(5);
+            Thread *t = GetThreadParam(tid);
+            if (t == NULL || priority < PRIO_HIGHEST || priority > PRIO_LOWEST) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",(t == NULL) ? tid : priority);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+              break;
+            }
+            g_scheduler -> SetPriority(t,priority);
+            g_machine -> WriteIntRegister(2,0);
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
+          case SC_GET_PRIORITY: {
+            DEBUG('e', (char*)"Scheduler: GetPriority call.\n");
+            int32_t tid = g_machine -> ReadIntRegister(4);
+            Thread *t = GetThreadParam(tid);
+            if (t == NULL) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",tid);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+              break;
+            }
+            g_machine -> WriteIntRegister(2,t -> GetPriority());
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
+          case SC_NICE: {
+            DEBUG('e', (char*)"Scheduler: Nice call.\n");
+            int increment = g_machine -> ReadIntRegister(4);
+            Process *p = g_current_thread -> GetProcessOwner();
+            int nice = p -> nice + increment;
+            if (nice < NICE_MIN) nice = NICE_MIN;
+            if (nice > NICE_MAX) nice = NICE_MAX;
+            p -> SetNice(nice);
+            g_machine -> WriteIntRegister(2,nice);
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
+          case SC_SET_REALTIME: {
+            DEBUG('e', (char*)"Scheduler: SetRealTime call.\n");
+            int period = g_machine -> ReadIntRegister(4);
+            int budget = g_machine -> ReadIntRegister(5);
+            int deadline = g_machine -> ReadIntRegister(6);
+            if (deadline == 0) deadline = period;
+            if (period == 0) {
+              g_scheduler -> LeaveRealTime(g_current_thread);
+            }
+            else if (period < 0 || budget <= 0 || budget > deadline
+                     || deadline > period) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"(period %d, budget %d, deadline %d)",period,budget,deadline);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+              break;
+            }
+            else if (!g_scheduler -> SetRealTime(g_current_thread,period,budget,deadline)) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"(period %d, budget %d, deadline %d)",period,budget,deadline);
+              g_syscall_error -> SetMsg(msg,REALTIME_REJECTED);
+              break;
+            }
+            g_machine -> WriteIntRegister(2,0);
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            // Let a thread with an earlier deadline run
+            g_current_thread -> Yield();
+            break;
+          }
+
+          case SC_WAIT_PERIOD: {
+            DEBUG('e', (char*)"Scheduler: WaitPeriod call.\n");
+            if (!g_current_thread -> IsRealTime()) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              g_syscall_error -> SetMsg(g_current_thread -> GetName(),INVALID_THREAD_ID);
+              break;
+            }
+            g_scheduler -> WaitPeriod(g_current_thread);
+            g_machine -> WriteIntRegister(2,0);
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
+          case SC_SLEEP: {
+            DEBUG('e', (char*)"Timer: Sleep call.\n");
+            int cycles = g_machine -> ReadIntRegister(4);
+            if (cycles < 0) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"(cycles %d)",cycles);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+              break;
+            }
+            if (cycles > 0)
+              g_scheduler -> SleepUntil(g_stats -> getTotalTicks() + cycles);
+            g_machine -> WriteIntRegister(2,0);
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
+          case SC_ALARM: {
+            DEBUG('e', (char*)"Timer: Alarm call.\n");
+            int32_t sid = g_machine -> ReadIntRegister(4);
+            int cycles = g_machine -> ReadIntRegister(5);
+            Semaphore *sema = (Semaphore *)g_object_ids -> SearchObject(sid);
+            if (!sema || sema -> type != SEMAPHORE_TYPE) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"%d",sid);
+              g_syscall_error -> SetMsg(msg,INVALID_SEMAPHORE_ID);
+              break;
+            }
+            if (cycles < 0) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"(cycles %d)",cycles);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+              break;
+            }
+            // An alarm replaces the previous one on the same semaphore,
+            // return what was left of it
+            Time now = g_stats -> getTotalTicks();
+            Time previous = g_scheduler -> CancelTimer(AlarmExpired,sid);
+            if (cycles > 0)
+              g_scheduler -> AddTimer(now + cycles,AlarmExpired,sid);
+            g_machine -> WriteIntRegister(2,previous > now ? (int)(previous - now) : 0);
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
+          case SC_FUTEX_WAIT: {
+            DEBUG('e', (char*)"Futex: Wait call.\n");
+            int32_t addr = g_machine -> ReadIntRegister(4);
+            int32_t expected = g_machine -> ReadIntRegister(5);
+            Process *p = g_current_thread -> GetProcessOwner();
+            if (addr < 0 || addr % 4 != 0
+                || p -> addrspace -> FindRegion(addr / g_cfg -> PageSize) == NULL) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"(0x%x)",addr);
+              g_syscall_error -> SetMsg(msg,INVALID_ADDRESS);
+              break;
+            }
+            // 1 when the word changed before the thread could sleep
+            g_machine -> WriteIntRegister(2,p -> FutexWait(addr,expected) ? 0 : 1);
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
+          }
+
+          case SC_FUTEX_WAKE: {
+            DEBUG('e', (char*)"Futex: Wake call.\n");
+            int32_t addr = g_machine -> ReadIntRegister(4);
+            int count = g_machine -> ReadIntRegister(5);
+            if (count < 0) {
+              g_machine -> WriteIntRegister(2,ERROR);
+              sprintf(msg,"(count %d)",count);
+              g_syscall_error -> SetMsg(msg,INVALID_ARGUMENT);
+              break;
+            }
+            Process *p = g_current_thread -> GetProcessOwner();
+            g_machine -> WriteIntRegister(2,p -> FutexWake(addr,count));
+            g_syscall_error -> SetMsg((char*)"",NO_ERROR);
+            break;
           }
 
         #endif
@@ -930,8 +1617,13 @@ void ExceptionHandler(ExceptionType exceptiontype, int vaddr)
     case ADDRESSERROR_EXCEPTION:
     printf("FATAL USER EXCEPTION (Thread %s, PC=0x%x):\n",
     g_current_thread->GetName(), g_machine->ReadIntRegister(PC_REG));
-    printf("\t*** Access to invalid or unmapped virtual address 0x%x ***\n",
-    vaddr);
+    if (g_current_thread->GetProcessOwner()->addrspace
+	->IsStackGuard(vaddr / g_cfg->PageSize))
+      printf("\t*** Stack overflow on access to virtual address 0x%x ***\n",
+      vaddr);
+    else
+      printf("\t*** Access to invalid or unmapped virtual address 0x%x ***\n",
+      vaddr);
     g_machine->interrupt->Halt(ERROR);
     break;
 
@@ -950,6 +1642,11 @@ void ExceptionHandler(ExceptionType exceptiontype, int vaddr)
     g_machine->interrupt->Halt(ERROR);
     break;
 
+    case FPUNUSABLE_EXCEPTION:
+    // Lazy floating point context switch, the instruction is restarted
+    g_current_thread->TakeFPU();
+    break;
+
     case PAGEFAULT_EXCEPTION:
     ExceptionType e;
     e = g_page_fault_manager->PageFault(vaddr / g_cfg->PageSize);
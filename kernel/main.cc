@@ -4,12 +4,19 @@
 // Usage: nachos -d <debugflags>
 //		-s -x <nachos file>
 //              -z -f <configfile> 
+//              -disk <file>
+//              -b <batchfile> -j <workers> -job
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -s causes user programs to be executed in single-step mode
 //    -z prints the copyright message
 //    -f <configfile> gives the name of a configuration file for Nachos
 //    -x runs a user program
+//    -disk <file> uses <file> (and <file>.swap) to simulate the disks
+//    -b runs the jobs of a batch file in parallel (see batch.cc), on
+//       at most <workers> host processes
+//    -job is given to the jobs of a batch: their disk is already
+//       initialized, so it is not formatted and no file is copied
 //
 */
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -53,6 +60,18 @@ main(int argc, char **argv)
   int argCount; // Number of arguments for a particular command
   int err;      // Error code
 
+  // Batch mode: each job is a separate Nachos machine
+  for (int i = 1; i < argc - 1; i++)
+    if (!strcmp(argv[i], "-b")) {
+      int workers = 0;
+      char *configfile = (char*)CONFIGFILENAME;
+      for (int j = 1; j < argc - 1; j++) {
+	if (!strcmp(argv[j], "-j")) workers = atoi(argv[j + 1]);
+	if (!strcmp(argv[j], "-f")) configfile = argv[j + 1];
+      }
+      exit(RunBatch(argv[i + 1], workers, argv[0], configfile) == 0 ? 0 : 1);
+    }
+
   // Init Nachos data structures
   Initialize(argc, argv);
   char * startfilename = g_cfg->ProgramToRun;
@@ -73,6 +92,10 @@ main(int argc, char **argv)
       printf ("   -x <binary>     : execute MIPS binary file <binary>\n");
       printf ("   -z              : print copyright information\n");
       printf ("   -f <cfgfile>    : use <cfgfile> instead of default configuration file nachos.cfg\n");
+      printf ("   -disk <file>    : use <file> and <file>.swap to simulate the disks\n");
+      printf ("   -b <batchfile>  : run the jobs of <batchfile> in parallel\n");
+      printf ("   -j <workers>    : number of jobs run at the same time in batch mode\n");
+      printf ("   -job            : batch job, do not format the disk nor copy files\n");
       printf ("   -h              : list command line arguments\n");
       exit(0);
     }
@@ -121,7 +144,7 @@ main(int argc, char **argv)
     }
     g_machine->mmu->translationTable = p->addrspace->translationTable;
     Thread * t = new Thread(startfilename);
-    g_object_ids->AddObject(t);
+    t->SetId(g_object_ids->AddObject(t));
     err = t->Start(p, p->addrspace->getCodeStartAddress(), -1);
   }
     
@@ -42,8 +42,16 @@ SyscallError::SyscallError() {
   msgs[INVALID_CONDITION_ID] = (char*)"invalid condition identifier %s\n";
   msgs[INVALID_FILE_ID] = (char*)"invalid file identifier %s\n";
   msgs[INVALID_THREAD_ID] = (char*)"invalid thread identifier %s\n";
+  msgs[INVALID_RWLOCK_ID] = (char*)"invalid reader-writer lock identifier %s\n";
+  msgs[INVALID_BARRIER_ID] = (char*)"invalid barrier identifier %s\n";
+  msgs[INVALID_PIPE_ID] = (char*)"invalid pipe identifier %s\n";
+  msgs[INVALID_MSGQUEUE_ID] = (char*)"invalid message queue identifier %s\n";
 
   msgs[NO_ACIA] = (char*)"no ACIA driver installed %s\n";
+
+  msgs[INVALID_ADDRESS] = (char*)"invalid or unmapped memory area %s\n";
+  msgs[INVALID_ARGUMENT] = (char*)"invalid argument %s\n";
+  msgs[REALTIME_REJECTED] = (char*)"real-time admission test failed %s\n";
 }
 
 
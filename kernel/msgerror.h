@@ -42,9 +42,17 @@ enum
   INVALID_CONDITION_ID,
   INVALID_FILE_ID,
   INVALID_THREAD_ID,
+  INVALID_RWLOCK_ID,
+  INVALID_BARRIER_ID,
+  INVALID_PIPE_ID,
+  INVALID_MSGQUEUE_ID,
 
   NO_ACIA,
 
+  INVALID_ADDRESS,
+  INVALID_ARGUMENT,
+  REALTIME_REJECTED,
+
   NUMMSGERROR /* Must always be last */
 };
 
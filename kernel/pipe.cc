@@ -0,0 +1,528 @@
+/*! \file  pipe.cc
+//  \brief Routines for the pipes and message queues
+//
+//  Copyright (c) 1999-2000 INSA de Rennes.
+//  All rights reserved.
+//  See copyright_insa.h for copyright notice and limitation
+//  of liability and disclaimer of warranty provisions.
+*/
+
+#include "kernel/system.h"
+#include "kernel/pipe.h"
+#include "kernel/thread.h"
+#include "kernel/addrspace.h"
+#include "kernel/region.h"
+#include "machine/machine.h"
+#include "vm/physMem.h"
+#include "vm/swapManager.h"
+#include "utility/stats.h"
+
+//----------------------------------------------------------------------
+// Frame
+/*! \return the address of a physical page in the machine memory
+*/
+//----------------------------------------------------------------------
+static char *Frame(int page)
+{
+  return (char *)&(g_machine->mainMemory[page * g_cfg->PageSize]);
+}
+
+//----------------------------------------------------------------------
+// CopyFromUser, CopyToUser
+/*! Copy bytes between the memory of the current process and the
+//  kernel.
+//
+// \param addr address in the current address space
+// \param buffer kernel buffer
+// \param size number of bytes
+*/
+//----------------------------------------------------------------------
+static void CopyFromUser(int32_t addr, char *buffer, int size)
+{
+  uint32_t c;
+  for (int i = 0; i < size; i++) {
+    g_machine->mmu->ReadMem(addr + i, 1, &c, false);
+    buffer[i] = c;
+  }
+  g_stats->incrPipeCopiedBytes(size);
+}
+
+static void CopyToUser(int32_t addr, char *buffer, int size)
+{
+  for (int i = 0; i < size; i++)
+    g_machine->mmu->WriteMem(addr + i, 1, buffer[i]);
+  g_stats->incrPipeCopiedBytes(size);
+}
+
+//----------------------------------------------------------------------
+// TakeUserPage
+/*! Take the physical page mapped at a page-aligned address of the
+//  current process, to move it in a pipe, when the process gives its
+//  buffer away. This is only done for writable pages which are
+//  zero-filled when accessed for the first time (stack, bss): after
+//  the move, the page of the process is zero-filled again on its next
+//  access. Pages locked in memory and pages of shared mappings are
+//  copied instead.
+//
+// \param addr page-aligned address in the current address space
+// \param frame the physical page, if it was taken
+// \return true if the page was taken
+*/
+//----------------------------------------------------------------------
+static bool TakeUserPage(int32_t addr, int *frame)
+{
+  AddrSpace *as = g_current_thread->GetProcessOwner()->addrspace;
+  TranslationTable *tt = as->translationTable;
+  int vp = addr / g_cfg->PageSize;
+  Region *r = as->FindRegion(vp);
+
+  if (!g_cfg->PipeZeroCopy || r == NULL || !(r->prot & REGION_WRITE)
+      || r->shared || r->FileOffset(vp) != -1)
+    return false;
+
+  // Bring the page in memory first: a page fault may switch to
+  // another thread
+  uint32_t c;
+  g_machine->mmu->ReadMem(addr, 1, &c, false);
+
+  IntStatus old_status = g_machine->interrupt->GetStatus();
+  g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+  bool taken = tt->getBitValid(vp) && !tt->getBitIo(vp)
+    && !g_physical_mem_manager->IsLocked(tt->getPhysicalPage(vp));
+  if (taken) {
+    *frame = tt->getPhysicalPage(vp);
+    g_physical_mem_manager->DetachPage(*frame);
+    // The copy of the page in the swap area is obsolete
+    if (tt->getBitSwap(vp)) {
+      g_swap_manager->ReleasePageSwap(tt->getAddrDisk(vp));
+      tt->clearBitSwap(vp);
+    }
+    tt->setAddrDisk(vp, -1);
+  }
+  g_machine->interrupt->SetStatus(old_status);
+  return taken;
+}
+
+//----------------------------------------------------------------------
+// GiveUserPage
+/*! Map a kernel page at a page-aligned address of the current
+//  process, instead of copying its contents. The physical page
+//  previously mapped there is freed. Pages which are not writable,
+//  locked in memory or part of a shared mapping are not replaced.
+//
+// \param addr page-aligned address in the current address space
+// \param frame the kernel page
+// \return true if the page was mapped
+*/
+//----------------------------------------------------------------------
+static bool GiveUserPage(int32_t addr, int frame)
+{
+  AddrSpace *as = g_current_thread->GetProcessOwner()->addrspace;
+  TranslationTable *tt = as->translationTable;
+  int vp = addr / g_cfg->PageSize;
+  Region *r = as->FindRegion(vp);
+
+  if (!g_cfg->PipeZeroCopy || r == NULL || !(r->prot & REGION_WRITE)
+      || r->shared || !tt->getBitWriteAllowed(vp))
+    return false;
+
+  IntStatus old_status = g_machine->interrupt->GetStatus();
+  g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+  bool given = !tt->getBitIo(vp)
+    && !(tt->getBitValid(vp)
+	 && g_physical_mem_manager->IsLocked(tt->getPhysicalPage(vp)));
+  if (given) {
+    if (tt->getBitValid(vp))
+      g_physical_mem_manager->RemovePhysicalToVirtualMapping(tt->getPhysicalPage(vp));
+    // The page is marked as modified, so its swap sector (if any) is
+    // rewritten when it is evicted
+    g_physical_mem_manager->AttachPage(frame, as, vp);
+  }
+  g_machine->interrupt->SetStatus(old_status);
+  return given;
+}
+
+//----------------------------------------------------------------------
+// NotifyReaders
+/*! Wake up the threads waiting for any of several objects (see
+//  WaitEvent), when a pipe or a queue may have become readable
+*/
+//----------------------------------------------------------------------
+static void NotifyReaders()
+{
+  IntStatus old_status = g_machine->interrupt->GetStatus();
+  g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+  NotifyEvent();
+  g_machine->interrupt->SetStatus(old_status);
+}
+
+//----------------------------------------------------------------------
+// PageRing::PageRing
+/*! Constructor. Create an empty ring
+//
+// \param nbSlots maximum number of pages in the ring
+*/
+//----------------------------------------------------------------------
+PageRing::PageRing(int nbSlots)
+{
+  nb_slots = nbSlots;
+  slots = new Slot[nbSlots];
+  first = nb_used = 0;
+}
+
+//----------------------------------------------------------------------
+// PageRing::~PageRing
+/*! Destructor. Free the pages of the ring
+*/
+//----------------------------------------------------------------------
+PageRing::~PageRing()
+{
+  while (nb_used > 0) {
+    g_physical_mem_manager->RemovePhysicalToVirtualMapping(slots[first].frame);
+    Pop();
+  }
+  delete [] slots;
+}
+
+//----------------------------------------------------------------------
+// PageRing::Push, PageRing::Pop
+/*! Append a slot holding the bytes [0,end[ of a page, remove the
+//  first slot (its page is not freed)
+*/
+//----------------------------------------------------------------------
+void PageRing::Push(int frame, int end)
+{
+  ASSERT(nb_used < nb_slots);
+  Slot *s = &slots[(first + nb_used) % nb_slots];
+  s->frame = frame;
+  s->start = 0;
+  s->end = end;
+  nb_used++;
+}
+
+void PageRing::Pop()
+{
+  ASSERT(nb_used > 0);
+  first = (first + 1) % nb_slots;
+  nb_used--;
+}
+
+//----------------------------------------------------------------------
+// PageRing::Put
+/*! Append bytes from the memory of the current process. The bytes
+//  are copied in the last page of the ring while it has room, and in
+//  new pages. When the process gives its buffer away, a whole page at
+//  a page-aligned address is moved into a new slot instead (see
+//  TakeUserPage).
+//
+// \param addr address of the bytes in the current address space
+// \param size number of bytes
+// \param new_page if true, the bytes start in a new slot
+// \param gift if true, whole pages may be taken from the process
+// \return the number of bytes appended, less than size when the
+//         ring is full
+*/
+//----------------------------------------------------------------------
+int PageRing::Put(int32_t addr, int size, bool new_page, bool gift)
+{
+  int put = 0;
+
+  while (put < size) {
+    int32_t a = addr + put;
+    int remaining = size - put;
+    Slot *last = Last();
+    int frame;
+
+    if (gift && remaining >= g_cfg->PageSize && a % g_cfg->PageSize == 0
+	&& nb_used < nb_slots && TakeUserPage(a, &frame)) {
+      Push(frame, g_cfg->PageSize);
+      g_stats->incrPipeMovedPages();
+      put += g_cfg->PageSize;
+      new_page = false;
+      continue;
+    }
+    if (last != NULL && !new_page && last->end < g_cfg->PageSize) {
+      int n = g_cfg->PageSize - last->end;
+      if (n > remaining) n = remaining;
+      CopyFromUser(a, Frame(last->frame) + last->end, n);
+      last->end += n;
+      put += n;
+      continue;
+    }
+    if (nb_used == nb_slots)
+      break;
+    // The new page is locked, and has no owner until it is freed or
+    // moved to a process
+    Push(g_physical_mem_manager->AddPhysicalToVirtualMapping(NULL, -1), 0);
+    new_page = false;
+  }
+  return put;
+}
+
+//----------------------------------------------------------------------
+// PageRing::Get
+/*! Remove bytes from the ring, and write them in the memory of the
+//  current process. A whole page of the ring read at a page-aligned
+//  address is moved to the process instead (see GiveUserPage). The
+//  pages which are emptied are freed.
+//
+// \param addr address in the current address space, or -1 to drop
+//        the bytes
+// \param size number of bytes
+// \return the number of bytes removed, less than size when the ring
+//         becomes empty
+*/
+//----------------------------------------------------------------------
+int PageRing::Get(int32_t addr, int size)
+{
+  int got = 0;
+
+  while (got < size && nb_used > 0) {
+    int32_t a = addr + got;
+    int remaining = size - got;
+    Slot *s = &slots[first];
+
+    if (addr != -1 && s->start == 0 && s->end == g_cfg->PageSize
+	&& remaining >= g_cfg->PageSize && a % g_cfg->PageSize == 0
+	&& GiveUserPage(a, s->frame)) {
+      Pop();
+      g_stats->incrPipeMovedPages();
+      got += g_cfg->PageSize;
+      continue;
+    }
+    int n = s->end - s->start;
+    if (n > remaining) n = remaining;
+    if (addr != -1)
+      CopyToUser(a, Frame(s->frame) + s->start, n);
+    s->start += n;
+    got += n;
+    if (s->start == s->end) {
+      g_physical_mem_manager->RemovePhysicalToVirtualMapping(s->frame);
+      Pop();
+    }
+  }
+  return got;
+}
+
+//----------------------------------------------------------------------
+// Pipe::Pipe
+/*! Constructor. Create an empty pipe of g_cfg->PipeSize pages
+//
+// \param debugName is an arbitrary name, useful for debugging.
+*/
+//----------------------------------------------------------------------
+Pipe::Pipe(char *debugName)
+{
+  name = new char[strlen(debugName)+1];
+  strcpy(name,debugName);
+  ring = new PageRing(g_cfg->PipeSize);
+  closed = false;
+  lock = new Lock(name);
+  not_empty = new Condition(name);
+  not_full = new Condition(name);
+  type = PIPE_TYPE;
+}
+
+//----------------------------------------------------------------------
+// Pipe::~Pipe
+/*! Destructor. Free the data which was not read
+*/
+//----------------------------------------------------------------------
+Pipe::~Pipe()
+{
+  type = INVALID_TYPE;
+  delete not_full;
+  delete not_empty;
+  delete lock;
+  delete ring;
+  delete [] name;
+}
+
+//----------------------------------------------------------------------
+// Pipe::Write
+/*! Write bytes of the current process in the pipe, waiting for room
+//  in the pipe as long as necessary.
+//
+// \param addr address of the bytes in the current address space
+// \param size number of bytes
+// \param gift if true, the whole pages of the buffer may be moved
+//        into the pipe, and the process reads them as zeroes afterwards
+// \return the number of bytes written, less than size if the pipe
+//         was closed meanwhile, or -1 if the pipe is closed
+*/
+//----------------------------------------------------------------------
+int Pipe::Write(int32_t addr, int size, bool gift)
+{
+  int written = 0;
+
+  lock->Acquire();
+  if (closed)
+    written = -1;
+  while (!closed) {
+    int n = ring->Put(addr + written, size - written, false, gift);
+    written += n;
+    if (n > 0) {
+      not_empty->Broadcast();
+      NotifyReaders();
+    }
+    if (written == size)
+      break;
+    not_full->Wait(lock);
+  }
+  lock->Release();
+  return written;
+}
+
+//----------------------------------------------------------------------
+// Pipe::Read
+/*! Read bytes from the pipe, waiting for data if the pipe is empty.
+//
+// \param addr address of the buffer in the current address space
+// \param size size of the buffer
+// \return the number of bytes read, 0 if the pipe is closed and empty
+*/
+//----------------------------------------------------------------------
+int Pipe::Read(int32_t addr, int size)
+{
+  lock->Acquire();
+  while (ring->IsEmpty() && !closed)
+    not_empty->Wait(lock);
+  int n = ring->Get(addr, size);
+  if (n > 0)
+    not_full->Broadcast();
+  lock->Release();
+  return n;
+}
+
+//----------------------------------------------------------------------
+// Pipe::Close
+/*! Mark the end of the data: the readers get the remaining bytes,
+//  then 0, and the writers fail.
+*/
+//----------------------------------------------------------------------
+void Pipe::Close()
+{
+  lock->Acquire();
+  closed = true;
+  not_empty->Broadcast();
+  not_full->Broadcast();
+  NotifyReaders();
+  lock->Release();
+}
+
+//----------------------------------------------------------------------
+// MsgQueue::MsgQueue
+/*! Constructor. Create an empty message queue
+//
+// \param debugName is an arbitrary name, useful for debugging.
+// \param maxMsgs maximum number of messages in the queue
+// \param maxSize maximum size of a message in bytes
+*/
+//----------------------------------------------------------------------
+MsgQueue::MsgQueue(char *debugName, int maxMsgs, int maxSize)
+{
+  ASSERT(ValidLimits(maxMsgs, maxSize));
+  name = new char[strlen(debugName)+1];
+  strcpy(name,debugName);
+  max_msgs = maxMsgs;
+  max_size = maxSize;
+  sizes = new int[maxMsgs];
+  first = nb_msgs = 0;
+  ring = new PageRing(maxMsgs * NbPages(maxSize));
+  lock = new Lock(name);
+  not_empty = new Condition(name);
+  not_full = new Condition(name);
+  type = MSGQUEUE_TYPE;
+}
+
+//----------------------------------------------------------------------
+// MsgQueue::ValidLimits
+/*! Check the limits of a new message queue. The ring of the queue
+//  must not take more than MSGQUEUE_MAX_PAGES kernel pages, which stay
+//  locked in memory while no receiver takes the messages. A message
+//  counts for at least one page, so that the number of messages is
+//  bounded too.
+//
+// \param maxMsgs maximum number of messages in the queue
+// \param maxSize maximum size of a message in bytes
+// \return true if the limits are valid
+*/
+//----------------------------------------------------------------------
+bool MsgQueue::ValidLimits(int maxMsgs, int maxSize)
+{
+  if (maxMsgs <= 0 || maxSize < 0)
+    return false;
+  int pages = NbPages(maxSize);
+  if (pages == 0)
+    pages = 1;
+  // maxMsgs * pages <= max, without overflow
+  return maxMsgs <= MSGQUEUE_MAX_PAGES(g_cfg) / pages;
+}
+
+//----------------------------------------------------------------------
+// MsgQueue::~MsgQueue
+/*! Destructor. Free the messages which were not received
+*/
+//----------------------------------------------------------------------
+MsgQueue::~MsgQueue()
+{
+  type = INVALID_TYPE;
+  delete not_full;
+  delete not_empty;
+  delete lock;
+  delete ring;
+  delete [] sizes;
+  delete [] name;
+}
+
+//----------------------------------------------------------------------
+// MsgQueue::Send
+/*! Add a message to the queue, waiting for room if the queue is
+//  full.
+//
+// \param addr address of the message in the current address space
+// \param size size of the message (at most getMaxSize())
+// \param gift if true, the whole pages of the message may be moved
+//        into the queue, and the process reads them as zeroes afterwards
+*/
+//----------------------------------------------------------------------
+void MsgQueue::Send(int32_t addr, int size, bool gift)
+{
+  ASSERT(size >= 0 && size <= max_size);
+  lock->Acquire();
+  while (nb_msgs == max_msgs || ring->FreeSlots() < NbPages(size))
+    not_full->Wait(lock);
+  int n = ring->Put(addr, size, true, gift);
+  ASSERT(n == size);
+  sizes[(first + nb_msgs) % max_msgs] = size;
+  nb_msgs++;
+  not_empty->Signal();
+  NotifyReaders();
+  lock->Release();
+}
+
+//----------------------------------------------------------------------
+// MsgQueue::Receive
+/*! Take the first message of the queue, waiting for one if the
+//  queue is empty.
+//
+// \param addr address of the buffer in the current address space
+// \param size size of the buffer: the end of a longer message is lost
+// \return the number of bytes copied in the buffer
+*/
+//----------------------------------------------------------------------
+int MsgQueue::Receive(int32_t addr, int size)
+{
+  lock->Acquire();
+  while (nb_msgs == 0)
+    not_empty->Wait(lock);
+  int len = sizes[first];
+  int n = (size < len) ? size : len;
+  ring->Get(addr, n);
+  ring->Get(-1, len - n);
+  first = (first + 1) % max_msgs;
+  nb_msgs--;
+  not_full->Broadcast();
+  lock->Release();
+  return n;
+}
@@ -0,0 +1,188 @@
+/*! \file  pipe.h
+    \brief Data structures for the communication between processes:
+           pipes and message queues.
+
+    The data in transit is kept in a bounded ring of physical pages
+    owned by the kernel. Bytes are copied between these pages and the
+    memory of the user programs, except for whole pages transferred at
+    page-aligned addresses when g_cfg->PipeZeroCopy is set: a sender
+    which gives its pages away (PipeGift, MsgGift) has them moved into
+    the ring, and a receiver gets the pages of the ring mapped in its
+    address space, without copying their contents (see PageRing::Put
+    and PageRing::Get). A plain write always copies, so that it leaves
+    the buffer of the sender unchanged.
+
+    Copyright (c) 1999-2000 INSA de Rennes.
+    All rights reserved.
+    See copyright_insa.h for copyright notice and limitation
+    of liability and disclaimer of warranty provisions.
+*/
+
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "kernel/copyright.h"
+#include "kernel/system.h"
+#include "kernel/synch.h"
+#include "utility/config.h"
+
+/*! \brief Defines a bounded ring of kernel pages holding a stream
+//  of bytes
+//
+// Each slot of the ring holds a physical page, with the bytes between
+// its start and end offsets. A page is taken for a slot when bytes are
+// written to it, and freed (or given to the receiver) when all its
+// bytes have been read. The ring does not synchronize its users.
+*/
+class PageRing {
+public:
+  //! Create an empty ring of nbSlots pages
+  PageRing(int nbSlots);
+
+  //! Free the ring and the pages it holds
+  ~PageRing();
+
+  /*! Append bytes from the memory of the current process
+   * \param addr address of the bytes in the current address space
+   * \param size number of bytes
+   * \param new_page if true, the bytes start in a new slot
+   * \param gift if true, whole pages may be taken from the process
+   * \return the number of bytes appended, less than size when the
+   *         ring is full
+   */
+  int Put(int32_t addr, int size, bool new_page, bool gift);
+
+  /*! Remove bytes from the ring, and write them in the memory of the
+   * current process (or drop them if addr is -1)
+   * \return the number of bytes removed, less than size when the ring
+   *         becomes empty
+   */
+  int Get(int32_t addr, int size);
+
+  bool IsEmpty() { return nb_used == 0; }                 //!< No bytes in the ring
+  int FreeSlots() { return nb_slots - nb_used; }          //!< Number of unused slots
+
+private:
+  //! A slot of the ring
+  struct Slot {
+    int frame;           //!< Physical page
+    int start;           //!< Offset of the first byte in the page
+    int end;             //!< Offset after the last byte in the page
+  };
+
+  Slot *slots;           //!< The slots
+  int nb_slots;          //!< Size of the ring
+  int first;             //!< Index of the first used slot
+  int nb_used;           //!< Number of used slots
+
+  Slot *Last() { return nb_used ? &slots[(first + nb_used - 1) % nb_slots] : NULL; }
+  void Push(int frame, int end);  //!< Append a slot
+  void Pop();                     //!< Remove the first slot
+};
+
+/*! \brief Defines a pipe: a bounded stream of bytes between threads,
+//  possibly of different processes
+//
+// Write blocks until all the bytes are in the pipe, and Read until
+// there are bytes to read. Once the pipe is closed, Read returns the
+// remaining bytes and then 0, and Write fails.
+*/
+class Pipe {
+public:
+  //! Create an empty pipe, of g_cfg->PipeSize pages
+  Pipe(char *debugName);
+
+  //! Delete the pipe (no thread must be waiting on it)
+  ~Pipe();
+
+  //! For debugging
+  char *getName() { return name; }
+
+  /*! Write size bytes at addr in the pipe, taking the whole pages of
+   * the buffer away from the process if gift is set. Return the number
+   * of bytes written, or -1 if the pipe is closed */
+  int Write(int32_t addr, int size, bool gift = false);
+
+  //! Read at most size bytes at addr. Return the number of bytes read, 0 at the end of the data
+  int Read(int32_t addr, int size);
+
+  //! Mark the end of the data, and wake up the waiting threads
+  void Close();
+
+  //! True if Read would not block
+  bool IsReadable() { return !ring->IsEmpty() || closed; }
+
+private:
+  char *name;            //!< For debugging
+  PageRing *ring;        //!< Data in transit
+  bool closed;           //!< No more data will be written
+  Lock *lock;            //!< Mutual exclusion on the ring
+  Condition *not_empty;  //!< Readers waiting for data
+  Condition *not_full;   //!< Writers waiting for room
+
+public:
+  //! Object type, for validity checks during system calls (must be the first public field)
+  ObjectType type;
+};
+
+//! Maximum number of kernel pages in the ring of a message queue: the
+//! pages of the ring stay locked in memory while they hold messages
+#define MSGQUEUE_MAX_PAGES(cfg) ((cfg)->NumPhysPages / 16)
+
+/*! \brief Defines a message queue: a bounded queue of messages
+//  between threads, possibly of different processes
+//
+// Unlike a pipe, the message boundaries are kept: Receive returns one
+// whole message. Each message starts on a new page of the ring, so
+// that the whole pages of a message can be moved to the receiver.
+*/
+class MsgQueue {
+public:
+  //! Create an empty queue of at most maxMsgs messages of maxSize bytes (see ValidLimits)
+  MsgQueue(char *debugName, int maxMsgs, int maxSize);
+
+  //! True if the ring of a queue with these limits fits in MSGQUEUE_MAX_PAGES(g_cfg)
+  static bool ValidLimits(int maxMsgs, int maxSize);
+
+  //! Delete the queue (no thread must be waiting on it)
+  ~MsgQueue();
+
+  //! For debugging
+  char *getName() { return name; }
+
+  //! Maximum size of a message
+  int getMaxSize() { return max_size; }
+
+  /*! Wait for room in the queue, and add the size bytes at addr as a
+   * message, taking the whole pages of the buffer away from the process
+   * if gift is set */
+  void Send(int32_t addr, int size, bool gift = false);
+
+  /*! Wait for a message and copy it at addr. A message longer than
+   * size bytes is truncated. Return the number of bytes copied */
+  int Receive(int32_t addr, int size);
+
+  //! True if Receive would not block
+  bool IsReadable() { return nb_msgs > 0; }
+
+private:
+  char *name;            //!< For debugging
+  int max_msgs;          //!< Maximum number of messages
+  int max_size;          //!< Maximum size of a message
+  int *sizes;            //!< Sizes of the messages, in a ring of max_msgs
+  int first;             //!< Index in sizes of the first message
+  int nb_msgs;           //!< Number of messages in the queue
+  PageRing *ring;        //!< Contents of the messages
+  Lock *lock;            //!< Mutual exclusion on the queue
+  Condition *not_empty;  //!< Receivers waiting for a message
+  Condition *not_full;   //!< Senders waiting for room
+
+  //! Number of slots of the ring used by a message
+  static int NbPages(int size) { return divRoundUp(size, g_cfg->PageSize); }
+
+public:
+  //! Object type, for validity checks during system calls (must be the first public field)
+  ObjectType type;
+};
+
+#endif // PIPE_H
@@ -5,6 +5,8 @@
 #include "kernel/system.h"
 #include "kernel/msgerror.h"
 #include "kernel/process.h"
+#include "kernel/scheduler.h"
+#include "userlib/syscall.h"
 
 //----------------------------------------------------------------------
 // Process::Process
@@ -19,6 +21,8 @@
 Process::Process(char *filename, int *err)
 {
   numThreads=0;
+  nice = NICE_DEFAULT;
+  vruntime = 0;
   *err = NO_ERROR;
   if (filename == NULL)
     {
@@ -68,6 +72,89 @@ Process::Process(char *filename, int *err)
 
 }
 
+//----------------------------------------------------------------------
+// Process::SetNice
+/*!   Change the nice value of the process, which gives its weight in
+//    the fair share scheduler
+//
+//    \param n the new nice value (NICE_MIN to NICE_MAX)
+*/
+//----------------------------------------------------------------------
+void Process::SetNice(int n)
+{
+  ASSERT(n >= NICE_MIN && n <= NICE_MAX);
+  nice = n;
+  stat->setWeight(Scheduler::NiceToWeight(n));
+}
+
+//----------------------------------------------------------------------
+// Process::FutexWait
+/*!   Put the current thread to sleep on a word of the address space
+//    (futex), unless the word no longer holds the expected value.
+//    The comparison and the sleep are atomic with respect to
+//    FutexWake, so that the user code can test the word, decide to
+//    wait, and not miss a wake up done in the meantime.
+//
+//    \param addr virtual address of the word (aligned and mapped)
+//    \param expected the value the word must hold to sleep
+//    \return true if the thread slept, false if the word changed
+*/
+//----------------------------------------------------------------------
+bool Process::FutexWait(int32_t addr, int32_t expected)
+{
+  uint32_t value;
+
+  // Bring the page of the word in memory first: a page fault may
+  // switch to another thread
+  g_machine->mmu->ReadMem(addr, 4, &value, false);
+  IntStatus oldLevel = g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+  g_machine->mmu->ReadMem(addr, 4, &value, false);
+  if ((int32_t)value != expected) {
+    g_machine->interrupt->SetStatus(oldLevel);
+    return false;
+  }
+
+  Listint *queue = futexQueues[addr];
+  if (queue == NULL) {
+    queue = new Listint;
+    futexQueues[addr] = queue;
+  }
+  queue->Append((void *)g_current_thread);
+  g_current_thread->Sleep();
+  g_machine->interrupt->SetStatus(oldLevel);
+  return true;
+}
+
+//----------------------------------------------------------------------
+// Process::FutexWake
+/*!   Wake up threads sleeping on a futex word, in the order they
+//    went to sleep.
+//
+//    \param addr virtual address of the word
+//    \param count maximum number of threads to wake up
+//    \return the number of threads woken up
+*/
+//----------------------------------------------------------------------
+int Process::FutexWake(int32_t addr, int count)
+{
+  int nb_woken = 0;
+  IntStatus oldLevel = g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+  std::map<int32_t, Listint *>::iterator it = futexQueues.find(addr);
+  if (it != futexQueues.end()) {
+    Listint *queue = it->second;
+    while (nb_woken < count && !queue->IsEmpty()) {
+      g_scheduler->ReadyToRun((Thread *)queue->Remove());
+      nb_woken++;
+    }
+    if (queue->IsEmpty()) {
+      delete queue;
+      futexQueues.erase(it);
+    }
+  }
+  g_machine->interrupt->SetStatus(oldLevel);
+  return nb_woken;
+}
+
 //----------------------------------------------------------------------
 // Process::~Process
 //!   Destructor. De-alloate a process and all its components
@@ -90,4 +177,10 @@ Process::~Process()
     // NB : don't delete the stat object, so that statistics can
     // be displayed after the end of the process
   } 
+
+  // Delete the futex wait queues still allocated
+  std::map<int32_t, Listint *>::iterator it;
+  for (it = futexQueues.begin(); it != futexQueues.end(); it++)
+    delete it->second;
+  futexQueues.clear();
 }
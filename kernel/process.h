@@ -14,6 +14,7 @@
 #include "kernel/addrspace.h"
 #include "filesys/openfile.h"
 #include "utility/stats.h"
+#include <map>
 
 class AddrSpace;
 class Thread;
@@ -45,8 +46,27 @@ public:
 
   char * getName() {return(name);}    /*!< Returns the process name */
 
+  int nice;                           /*!< Nice value of the process
+                                        (fair share scheduler) */
+
+  Time vruntime;                      /*!< CPU time used by the threads
+                                        of the process, weighted by its
+                                        nice value (fair share scheduler) */
+
+  void SetNice(int nice);             /*!< Change the nice value */
+
+  /*! Put the current thread to sleep on a futex word of the address
+   * space, if it still holds the expected value */
+  bool FutexWait(int32_t addr, int32_t expected);
+
+  /*! Wake up threads sleeping on a futex word */
+  int FutexWake(int32_t addr, int count);
+
 private:
   char *name;
+
+  //! Threads sleeping on a futex word, by address of the word
+  std::map<int32_t, Listint *> futexQueues;
 };
 
 #endif // PROCESS_H
@@ -0,0 +1,335 @@
+/*! \file  region.cc
+//  \brief Routines to manage the regions of an address space
+//
+//  Copyright (c) 1999-2000 INSA de Rennes.
+//  All rights reserved.
+//  See copyright_insa.h for copyright notice and limitation
+//  of liability and disclaimer of warranty provisions.
+*/
+
+#include "kernel/system.h"
+#include "utility/config.h"
+#include "userlib/syscall.h"
+#include "filesys/openfile.h"
+#include "kernel/region.h"
+
+//----------------------------------------------------------------------
+// Region::Region
+/*! Constructor. Create a region which is not yet in any tree
+//
+// \param first_page first virtual page of the region
+// \param nb_pages number of virtual pages of the region
+// \param prot access rights (REGION_READ, REGION_WRITE, REGION_EXEC)
+// \param backing backing store of the region
+// \param file file backing the region (REGION_FILE only)
+// \param file_offset offset in the file of the first page (in bytes)
+// \param file_size number of bytes of the region backed by the file
+*/
+//----------------------------------------------------------------------
+Region::Region(int first_page, int nb_pages, int prot, RegionBacking backing,
+	       OpenFile *file, int file_offset, int file_size)
+{
+  this->first_page = first_page;
+  this->nb_pages = nb_pages;
+  this->prot = prot;
+  this->backing = backing;
+  this->file = file;
+  this->file_offset = file_offset;
+  this->file_size = file_size;
+  shared = false;
+  advice = MADV_NORMAL;
+  last_fault = -1;
+  stack_limit = first_page;
+  left = right = NULL;
+  height = 1;
+  max_end = first_page + nb_pages;
+}
+
+//----------------------------------------------------------------------
+// Region::FileOffset
+/*! Return the offset in the backing file of a page of the region
+//
+// \param virtualPage a virtual page of the region
+// \return the offset in bytes, or -1 when the page has no image in
+//         the file and must be zero-filled
+*/
+//----------------------------------------------------------------------
+int Region::FileOffset(int virtualPage)
+{
+  ASSERT(Contains(virtualPage));
+  int offset = (virtualPage - first_page) * g_cfg->PageSize;
+  if (backing != REGION_FILE || offset >= file_size)
+    return -1;
+  return file_offset + offset;
+}
+
+//----------------------------------------------------------------------
+// Region::ReadPage
+/*! Fill a physical page with the initial contents of a page of the
+//  region: its image in the backing file, completed with zeroes.
+//
+// \param virtualPage a virtual page of the region
+// \param frame address of the physical page in the machine memory
+*/
+//----------------------------------------------------------------------
+void Region::ReadPage(int virtualPage, char *frame)
+{
+  int offset = FileOffset(virtualPage);
+  int nb_read = 0;
+
+  if (offset != -1) {
+    int len = file_offset + file_size - offset;
+    if (len > g_cfg->PageSize) len = g_cfg->PageSize;
+    nb_read = file->ReadAt(frame, len, offset);
+    if (nb_read < 0) nb_read = 0;
+  }
+  memset(frame + nb_read, 0, g_cfg->PageSize - nb_read);
+}
+
+//----------------------------------------------------------------------
+// Region::WritePage
+/*! Write a page of a shared file mapping back to the file. Only
+//  the part of the page backed by the file is written.
+//
+// \param virtualPage a virtual page of the region
+// \param frame address of the physical page in the machine memory
+*/
+//----------------------------------------------------------------------
+void Region::WritePage(int virtualPage, char *frame)
+{
+  ASSERT(shared);
+  int offset = FileOffset(virtualPage);
+  if (offset == -1) return;
+
+  int len = file_offset + file_size - offset;
+  if (len > g_cfg->PageSize) len = g_cfg->PageSize;
+  file->WriteAt(frame, len, offset);
+}
+
+//----------------------------------------------------------------------
+// RegionTree::RegionTree
+/*! Constructor. Create an empty tree
+*/
+//----------------------------------------------------------------------
+RegionTree::RegionTree()
+{
+  root = NULL;
+  size = 0;
+}
+
+//----------------------------------------------------------------------
+// RegionTree::Update
+/*! Recompute the height and the highest end page of a node from
+//  its children
+*/
+//----------------------------------------------------------------------
+void RegionTree::Update(Region *n)
+{
+  int hl = Height(n->left), hr = Height(n->right);
+  n->height = 1 + (hl > hr ? hl : hr);
+  n->max_end = n->EndPage();
+  if (n->left && n->left->max_end > n->max_end)
+    n->max_end = n->left->max_end;
+  if (n->right && n->right->max_end > n->max_end)
+    n->max_end = n->right->max_end;
+}
+
+//----------------------------------------------------------------------
+// RegionTree::RotateLeft, RegionTree::RotateRight
+/*! AVL rotations
+//
+// \param n root of the sub-tree to rotate
+// \return the new root of the sub-tree
+*/
+//----------------------------------------------------------------------
+Region *RegionTree::RotateLeft(Region *n)
+{
+  Region *r = n->right;
+  n->right = r->left;
+  r->left = n;
+  Update(n);
+  Update(r);
+  return r;
+}
+
+Region *RegionTree::RotateRight(Region *n)
+{
+  Region *l = n->left;
+  n->left = l->right;
+  l->right = n;
+  Update(n);
+  Update(l);
+  return l;
+}
+
+//----------------------------------------------------------------------
+// RegionTree::Balance
+/*! Restore the AVL property at a node whose children are balanced
+//
+// \param n root of the sub-tree
+// \return the new root of the sub-tree
+*/
+//----------------------------------------------------------------------
+Region *RegionTree::Balance(Region *n)
+{
+  Update(n);
+  int diff = Height(n->left) - Height(n->right);
+  if (diff > 1) {
+    if (Height(n->left->left) < Height(n->left->right))
+      n->left = RotateLeft(n->left);
+    return RotateRight(n);
+  }
+  if (diff < -1) {
+    if (Height(n->right->right) < Height(n->right->left))
+      n->right = RotateRight(n->right);
+    return RotateLeft(n);
+  }
+  return n;
+}
+
+//----------------------------------------------------------------------
+// RegionTree::Insert
+/*! Insert a region in the tree. The region must not overlap any
+//  region of the tree.
+//
+// \param r the region to insert
+*/
+//----------------------------------------------------------------------
+void RegionTree::Insert(Region *r)
+{
+  ASSERT(FirstOverlap(r->first_page, r->EndPage()) == NULL);
+  r->left = r->right = NULL;
+  r->height = 1;
+  r->max_end = r->EndPage();
+  root = Insert(root, r);
+  size++;
+}
+
+Region *RegionTree::Insert(Region *n, Region *r)
+{
+  if (n == NULL) return r;
+  if (r->first_page < n->first_page)
+    n->left = Insert(n->left, r);
+  else
+    n->right = Insert(n->right, r);
+  return Balance(n);
+}
+
+//----------------------------------------------------------------------
+// RegionTree::Remove
+/*! Remove a region from the tree (the region is not deleted)
+//
+// \param r the region to remove, which must be in the tree
+*/
+//----------------------------------------------------------------------
+void RegionTree::Remove(Region *r)
+{
+  root = Remove(root, r);
+  r->left = r->right = NULL;
+  size--;
+}
+
+Region *RegionTree::RemoveMin(Region *n, Region **min)
+{
+  if (n->left == NULL) {
+    *min = n;
+    return n->right;
+  }
+  n->left = RemoveMin(n->left, min);
+  return Balance(n);
+}
+
+Region *RegionTree::Remove(Region *n, Region *r)
+{
+  ASSERT(n != NULL);
+  if (r->first_page < n->first_page)
+    n->left = Remove(n->left, r);
+  else if (r->first_page > n->first_page)
+    n->right = Remove(n->right, r);
+  else {
+    ASSERT(n == r);
+    if (n->right == NULL) return n->left;
+    Region *min;
+    Region *right = RemoveMin(n->right, &min);
+    min->left = n->left;
+    min->right = right;
+    return Balance(min);
+  }
+  return Balance(n);
+}
+
+//----------------------------------------------------------------------
+// RegionTree::Find
+/*! Return the region containing a virtual page
+//
+// \param virtualPage the virtual page to look for
+// \return the region, or NULL when the page is not in any region
+*/
+//----------------------------------------------------------------------
+Region *RegionTree::Find(int virtualPage)
+{
+  return FirstOverlap(virtualPage, virtualPage + 1);
+}
+
+//----------------------------------------------------------------------
+// RegionTree::FirstOverlap
+/*! Return the lowest region overlapping a range of virtual pages.
+//  Sub-trees whose highest end page is below the range are skipped.
+//
+// \param first_page first virtual page of the range
+// \param end_page first virtual page after the range
+// \return the region, or NULL when no region overlaps the range
+*/
+//----------------------------------------------------------------------
+Region *RegionTree::FirstOverlap(int first_page, int end_page)
+{
+  return FirstOverlap(root, first_page, end_page);
+}
+
+Region *RegionTree::FirstOverlap(Region *n, int first_page, int end_page)
+{
+  if (n == NULL || n->max_end <= first_page)
+    return NULL;
+  Region *r = FirstOverlap(n->left, first_page, end_page);
+  if (r != NULL)
+    return r;
+  if (n->first_page >= end_page)
+    return NULL;
+  if (n->EndPage() > first_page)
+    return n;
+  return FirstOverlap(n->right, first_page, end_page);
+}
+
+//----------------------------------------------------------------------
+// RegionTree::Split
+/*! Split a region in two parts at a virtual page. Both parts keep
+//  the access rights, backing store and hints of the original region.
+//
+// \param r the region to split, which must be in the tree
+// \param virtualPage first virtual page of the second part, strictly
+//        inside the region
+// \return the second part, inserted in the tree
+*/
+//----------------------------------------------------------------------
+Region *RegionTree::Split(Region *r, int virtualPage)
+{
+  ASSERT(virtualPage > r->first_page && virtualPage < r->EndPage());
+
+  int offset = (virtualPage - r->first_page) * g_cfg->PageSize;
+  Region *n = new Region(virtualPage, r->EndPage() - virtualPage, r->prot,
+			 r->backing, r->file, r->file_offset + offset,
+			 r->file_size > offset ? r->file_size - offset : 0);
+  n->shared = r->shared;
+  n->advice = r->advice;
+  n->last_fault = r->last_fault;
+  n->stack_limit = r->stack_limit;
+
+  // The first page of r does not change but its end does, so r is
+  // re-inserted to update the highest end pages of the tree
+  Remove(r);
+  r->nb_pages = virtualPage - r->first_page;
+  r->file_size = (r->file_size > offset) ? offset : r->file_size;
+  Insert(r);
+  Insert(n);
+  return n;
+}
@@ -0,0 +1,141 @@
+/*! \file  region.h
+    \brief Data structures describing the regions (virtual memory
+           areas) of an address space.
+
+    A region is a range of contiguous virtual pages sharing the same
+    access rights and the same backing store. The regions of an
+    address space are kept in an interval tree (an AVL tree ordered
+    on the first page of the regions, each node also remembering the
+    highest end page of its sub-tree), so that the region containing
+    a given page is found in O(log n).
+
+    Copyright (c) 1999-2000 INSA de Rennes.
+    All rights reserved.
+    See copyright_insa.h for copyright notice and limitation
+    of liability and disclaimer of warranty provisions.
+*/
+
+#ifndef REGION_H
+#define REGION_H
+
+#include "kernel/copyright.h"
+
+class OpenFile;
+
+//! Access rights of a region
+#define REGION_READ  0x1
+#define REGION_WRITE 0x2
+#define REGION_EXEC  0x4
+
+//! Backing store of a region, used to load pages accessed for the first time
+enum RegionBacking {
+  REGION_ANON,   //!< zero-filled pages (bss)
+  REGION_FILE,   //!< pages read from a file (executable sections, mmap)
+  REGION_STACK   //!< zero-filled pages of a thread stack
+};
+
+/*! \brief Defines a region of an address space
+//
+// Pages of a region are loaded from its backing store the first time
+// they are accessed, and from the swap area afterwards, except for
+// shared file mappings whose modified pages are written back to the
+// file.
+*/
+class Region {
+public:
+  /*! Create a region
+   * \param first_page first virtual page of the region
+   * \param nb_pages number of virtual pages of the region
+   * \param prot access rights (REGION_READ, REGION_WRITE, REGION_EXEC)
+   * \param backing backing store of the region
+   * \param file file backing the region (REGION_FILE only)
+   * \param file_offset offset in the file of the first page (in bytes)
+   * \param file_size number of bytes of the region backed by the
+   *        file, the rest of the region is zero-filled
+   */
+  Region(int first_page, int nb_pages, int prot, RegionBacking backing,
+	 OpenFile *file = 0, int file_offset = 0, int file_size = 0);
+
+  int first_page;         //!< First virtual page of the region
+  int nb_pages;           //!< Number of virtual pages of the region
+  int prot;               //!< Access rights (REGION_READ|REGION_WRITE|REGION_EXEC)
+  RegionBacking backing;  //!< Backing store of the region
+  OpenFile *file;         //!< File backing the region (REGION_FILE only)
+  int file_offset;        //!< Offset in the file of the first page (bytes)
+  int file_size;          //!< Number of bytes backed by the file
+  bool shared;            //!< Modified pages are written back to the file
+  int advice;             //!< Access pattern hint (see Madvise)
+  int last_fault;         //!< Last page fault in the region (MADV_SEQUENTIAL only)
+  int stack_limit;        //!< Lowest page a stack region may grow down to
+
+  //! End of the region (first virtual page after the region)
+  int EndPage() { return first_page + nb_pages; }
+
+  //! True if the virtual page belongs to the region
+  bool Contains(int virtualPage)
+    { return virtualPage >= first_page && virtualPage < EndPage(); }
+
+  /*! Return the offset in the backing file of a page of the region, or
+   *  -1 when the page has no image in the file (it is zero-filled) */
+  int FileOffset(int virtualPage);
+
+  //! Fill a physical page with the initial contents of a page of the region
+  void ReadPage(int virtualPage, char *frame);
+
+  //! Write a modified page of a shared file mapping back to the file
+  void WritePage(int virtualPage, char *frame);
+
+private:
+  Region *left;           //!< Sub-tree of the regions before this one
+  Region *right;          //!< Sub-tree of the regions after this one
+  int height;             //!< Height of the sub-tree rooted at this region
+  int max_end;            //!< Highest end page of the sub-tree
+
+  friend class RegionTree;
+};
+
+/*! \brief Defines the interval tree of the regions of an address space
+//
+// Regions of the tree must not overlap. The tree does not own the
+// regions: removing a region or deleting the tree does not delete them.
+*/
+class RegionTree {
+public:
+  RegionTree();           //!< Create an empty tree
+
+  void Insert(Region *r); //!< Insert a region in the tree
+  void Remove(Region *r); //!< Remove a region from the tree
+
+  //! Return the region containing a virtual page, or NULL
+  Region *Find(int virtualPage);
+
+  /*! Return the lowest region overlapping the virtual pages
+   * [first_page,end_page[, or NULL */
+  Region *FirstOverlap(int first_page, int end_page);
+
+  /*! Split a region in two at a virtual page, and return the new region
+   * (the part of the region starting at virtualPage) */
+  Region *Split(Region *r, int virtualPage);
+
+  //! Return true if there is no region in the tree
+  bool IsEmpty() { return root == 0; }
+
+  //! Return the number of regions in the tree
+  int Size() { return size; }
+
+private:
+  Region *root;           //!< Root of the tree
+  int size;               //!< Number of regions in the tree
+
+  static int Height(Region *n) { return n ? n->height : 0; }
+  static void Update(Region *n);
+  static Region *RotateLeft(Region *n);
+  static Region *RotateRight(Region *n);
+  static Region *Balance(Region *n);
+  static Region *Insert(Region *n, Region *r);
+  static Region *RemoveMin(Region *n, Region **min);
+  static Region *Remove(Region *n, Region *r);
+  static Region *FirstOverlap(Region *n, int first_page, int end_page);
+};
+
+#endif // REGION_H
@@ -10,7 +10,9 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
+// 	One FIFO list per priority, the first thread of the highest
+//	priority non-empty list is chosen (see scheduler.h for the
+//	policies).
 */
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -20,32 +22,85 @@
 #include "kernel/scheduler.h"
 #include "kernel/system.h"
 #include "kernel/thread.h"
+#include "kernel/process.h"
+#include "kernel/synch.h"
+#include "utility/config.h"
+#include "utility/stats.h"
+#include "userlib/syscall.h"
+#include "machine/timer.h"
+
+//! Weights of the nice values NICE_MIN to NICE_MAX: each nice level
+//! changes the CPU share of a process by about 10%
+static const int nice_to_weight[NICE_MAX - NICE_MIN + 1] = {
+ /* -20 */     88761,     71755,     56483,     46273,     36291,
+ /* -15 */     29154,     23254,     18705,     14949,     11916,
+ /* -10 */      9548,      7620,      6100,      4904,      3906,
+ /*  -5 */      3121,      2501,      1991,      1586,      1277,
+ /*   0 */      1024,       820,       655,       526,       423,
+ /*   5 */       335,       272,       215,       172,       137,
+ /*  10 */       110,        87,        70,        56,        45,
+ /*  15 */        36,        29,        23,        18,        15,
+};
 
 //----------------------------------------------------------------------
 //  Scheduler::Scheduler
-/*! 	Constructor. Initialize the list of ready but not 
+/*! 	Constructor. Initialize the lists of ready but not 
 //      running threads to empty.
 */
 //----------------------------------------------------------------------
 Scheduler::Scheduler()
 { 
-    readyList = new Listint; 
+    for (int i = 0; i < NB_RUN_QUEUES; i++) {
+      readyList[i] = new Listint; 
+      levelDispatches[i] = 0;
+      levelTicks[i] = 0;
+    }
+    readyMask = 0;
+    rtReadyList = new ListTime;
+    timerQueue = new ListTime;
+    rtLoad = 0;
+    minVruntime = 0;
+    lastBoost = 0;
+    nbBoosts = nbDemotions = nbPromotions = 0;
 } 
 
 //----------------------------------------------------------------------
 // Scheduler::~Scheduler
-/*! 	Destructor. De-allocate the list of ready threads.
+/*! 	Destructor. De-allocate the lists of ready threads.
 */
 //----------------------------------------------------------------------
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    for (int i = 0; i < NB_RUN_QUEUES; i++)
+      delete readyList[i]; 
+    delete rtReadyList;
+    while (!timerQueue->IsEmpty())
+      delete (KernelTimer *)timerQueue->Remove();
+    delete timerQueue;
 } 
 
+//----------------------------------------------------------------------
+// Scheduler::RunQueue
+/*! 	\return the run queue of a thread: its level in the multilevel
+//	feedback queue, or its fixed priority
+//	\param thread the thread
+*/
+//----------------------------------------------------------------------
+int
+Scheduler::RunQueue(Thread *thread)
+{
+    if (g_cfg->SchedPolicy == SCHED_PRIORITY)
+      return thread->priority;
+    return thread->level;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 /*! 	Mark a thread as ready, but not necessarily running yet.
-//	Put it in the ready list, for later scheduling onto the CPU.
+//	Put it in its run queue, for later scheduling onto the CPU. In
+//	the multilevel feedback queue, a thread which was blocked before
+//	the end of its quantum moves up one level. Real-time threads are
+//	kept apart, by absolute deadline.
 //
 //	\param thread is the thread to be put on the ready list.
 */
@@ -53,26 +108,707 @@ Scheduler::~Scheduler()
 void
 Scheduler::ReadyToRun (Thread *thread)
 {
-    DEBUG('t', (char *)"Putting thread %s in ready list.\n", thread->GetName());
-    readyList->Append((void *)thread);
+    if (thread->blocked) {
+      thread->blocked = false;
+      if (g_cfg->SchedPolicy == SCHED_MLFQ && thread->level > 0) {
+	thread->level--;
+	nbPromotions++;
+      }
+    }
+    if (thread->realtime) {
+      DEBUG('t', (char *)"Putting real-time thread %s in ready list (deadline %llu).\n",
+	    thread->GetName(), thread->rt_abs_deadline);
+      rtReadyList->SortedInsert((void *)thread, thread->rt_abs_deadline);
+      UpdateTimer();
+      return;
+    }
+    if (g_cfg->SchedPolicy == SCHED_FAIR) {
+      DEBUG('t', (char *)"Putting thread %s in fair share tree.\n",
+	    thread->GetName());
+      FairEnqueue(thread);
+    }
+    else {
+      int queue = RunQueue(thread);
+      DEBUG('t', (char *)"Putting thread %s in ready list %d.\n",
+	    thread->GetName(), queue);
+      readyList[queue]->Append((void *)thread);
+      readyMask |= 1U << queue;
+    }
+    // The running thread may now have to be preempted
+    UpdateTimer();
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
-/*! 	Return the next thread to be scheduled onto the CPU.
+/*! 	Return the next thread to be scheduled onto the CPU: the ready
+//	real-time thread with the earliest deadline if any, else the first
+//	thread of the highest priority non-empty run queue, found in
+//	constant time with the bitmap of the non-empty run queues.
 //	If there are no ready threads, return NULL.
 // Side effect:
-//	Thread is removed from the ready list.
+//	Thread is removed from the ready list. In the multilevel feedback
+//	queue, all threads are moved back to the highest level every
+//	g_cfg->BoostPeriod cycles.
 // \return Thread to be scheduled on the CPU
 */
 //----------------------------------------------------------------------
 Thread *
 Scheduler::FindNextToRun ()
 {
-  Thread * thread=(Thread*)readyList->Remove();
+  if (g_cfg->SchedPolicy == SCHED_MLFQ && g_cfg->BoostPeriod > 0
+      && g_stats->getTotalTicks() - lastBoost >= (Time)g_cfg->BoostPeriod)
+    Boost();
+
+  if (!rtReadyList->IsEmpty())
+    return (Thread *)rtReadyList->Remove();
+
+  if (g_cfg->SchedPolicy == SCHED_FAIR)
+    return FairDequeue();
+
+  if (readyMask == 0)
+    return NULL;
+
+  // Lowest set bit: highest priority non-empty run queue
+  int queue = __builtin_ctz(readyMask);
+  Thread *thread = (Thread*)readyList[queue]->Remove();
+  if (readyList[queue]->IsEmpty())
+    readyMask &= ~(1U << queue);
+  levelDispatches[queue]++;
   return thread;
 }
 
+//----------------------------------------------------------------------
+// Scheduler::RemoveReady
+/*! 	Remove a given thread from the ready list, so that the current
+//	thread can give it the CPU directly (see Thread::YieldTo). Real-time
+//	threads are only dispatched by deadline: the thread is not removed
+//	if it is a real-time thread, or if a real-time thread is ready.
+//
+//	\param thread the thread
+//	\return true if the thread was ready and was removed
+*/
+//----------------------------------------------------------------------
+bool
+Scheduler::RemoveReady(Thread *thread)
+{
+    if (thread->realtime || !rtReadyList->IsEmpty())
+      return false;
+
+    if (g_cfg->SchedPolicy == SCHED_FAIR) {
+      Process *process = thread->GetProcessOwner();
+      std::map<Process*, ThreadTree>::iterator it = fairThreads.find(process);
+      if (it == fairThreads.end())
+	return false;
+      ThreadTree::iterator t;
+      for (t = it->second.lower_bound(thread->vruntime);
+	   t != it->second.end() && t->second != thread; t++)
+	;
+      if (t == it->second.end())
+	return false;
+      it->second.erase(t);
+      if (it->second.empty()) {
+	FairRemoveProcess(process);
+	fairThreads.erase(it);
+      }
+      levelDispatches[0]++;
+      return true;
+    }
+
+    int queue = RunQueue(thread);
+    if (!readyList[queue]->Search(thread))
+      return false;
+    readyList[queue]->RemoveItem(thread);
+    if (readyList[queue]->IsEmpty())
+      readyMask &= ~(1U << queue);
+    levelDispatches[queue]++;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Boost
+/*! 	Move all threads back to the highest priority level, so that
+//	threads of the lowest levels do not starve and threads which
+//	became interactive again are not stuck at a low level.
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::ResetLevel(int64_t thread)
+{
+    ((Thread *)thread)->level = 0;
+}
+
+void
+Scheduler::Boost()
+{
+    DEBUG('t', (char *)"Priority boost at time %llu\n", g_stats->getTotalTicks());
+    lastBoost = g_stats->getTotalTicks();
+    nbBoosts++;
+    for (int i = 1; i < NB_PRIORITY_LEVELS; i++)
+      while (!readyList[i]->IsEmpty())
+	readyList[0]->Append(readyList[i]->Remove());
+    if (readyMask != 0)
+      readyMask = 1;
+    g_alive->Mapcar(ResetLevel);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Quantum
+/*! 	\return the quantum of a thread, which doubles at each level of
+//	the multilevel feedback queue
+//	\param thread the thread
+*/
+//----------------------------------------------------------------------
+Time
+Scheduler::Quantum(Thread *thread)
+{
+    if (g_cfg->SchedPolicy == SCHED_PRIORITY)
+      return g_cfg->Quantum;
+    return (Time)g_cfg->Quantum << thread->level;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::QuantumExpired
+/*! 	Called by the timer interrupt handler when a thread has used its
+//	whole quantum: in the multilevel feedback queue, the thread moves
+//	down one level.
+//
+//	\param thread the running thread
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::QuantumExpired(Thread *thread)
+{
+    thread->Preempted();
+    if (g_cfg->SchedPolicy == SCHED_MLFQ
+	&& thread->level < NB_PRIORITY_LEVELS - 1) {
+      thread->level++;
+      nbDemotions++;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::AccountCpuTime
+/*! 	Account for the CPU time used by a thread at its current level
+//
+//	\param thread the thread
+//	\param ticks the CPU time used
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::AccountCpuTime(Thread *thread, Time ticks)
+{
+    if (g_cfg->SchedPolicy != SCHED_FAIR) {
+      levelTicks[RunQueue(thread)] += ticks;
+      return;
+    }
+
+    // The process moves in the tree when its virtual runtime changes
+    Process *process = thread->GetProcessOwner();
+    bool queued = fairThreads.count(process) != 0;
+    if (queued)
+      FairRemoveProcess(process);
+    thread->vruntime += ticks;
+    process->vruntime += ticks * NICE_0_WEIGHT / NiceToWeight(process->nice);
+    if (queued)
+      fairTree.insert(std::make_pair(process->vruntime, process));
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NiceToWeight
+/*! 	\return the weight of a process in the fair share scheduler
+//	\param nice the nice value of the process
+*/
+//----------------------------------------------------------------------
+int
+Scheduler::NiceToWeight(int nice)
+{
+    return nice_to_weight[nice - NICE_MIN];
+}
+
+//----------------------------------------------------------------------
+// Scheduler::FairEnqueue
+/*! 	Fair share scheduler: put a thread in the tree of the ready
+//	threads of its process, and the process in the tree of the
+//	processes if it had no ready thread. A process (or thread) which
+//	did not run for a long time gets at most one quantum of advance
+//	over the others, so that it cannot monopolize the CPU.
+//
+//	\param thread the thread
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::FairEnqueue(Thread *thread)
+{
+    Process *process = thread->GetProcessOwner();
+    std::map<Process*, ThreadTree>::iterator it = fairThreads.find(process);
+
+    if (it == fairThreads.end()) {
+      if (process->vruntime + g_cfg->Quantum < minVruntime)
+	process->vruntime = minVruntime - g_cfg->Quantum;
+      fairTree.insert(std::make_pair(process->vruntime, process));
+      it = fairThreads.insert(std::make_pair(process, ThreadTree())).first;
+    }
+    else {
+      Time min = it->second.begin()->first;
+      if (thread->vruntime + g_cfg->Quantum < min)
+	thread->vruntime = min - g_cfg->Quantum;
+    }
+    it->second.insert(std::make_pair(thread->vruntime, thread));
+}
+
+//----------------------------------------------------------------------
+// Scheduler::FairDequeue
+/*! 	Fair share scheduler: remove from the trees the thread with the
+//	smallest CPU time of the process with the smallest virtual
+//	runtime.
+//
+//	\return the thread, or NULL if no thread is ready
+*/
+//----------------------------------------------------------------------
+Thread *
+Scheduler::FairDequeue()
+{
+    if (fairTree.empty())
+      return NULL;
+
+    Process *process = fairTree.begin()->second;
+    if (process->vruntime > minVruntime)
+      minVruntime = process->vruntime;
+
+    std::map<Process*, ThreadTree>::iterator it = fairThreads.find(process);
+    ASSERT(it != fairThreads.end() && !it->second.empty());
+    Thread *thread = it->second.begin()->second;
+    it->second.erase(it->second.begin());
+
+    // The process stays in the tree while it has ready threads
+    if (it->second.empty()) {
+      FairRemoveProcess(process);
+      fairThreads.erase(it);
+    }
+    levelDispatches[0]++;
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::FairRemoveProcess
+/*! 	Fair share scheduler: remove a process from the tree of the
+//	processes (its threads stay in its own tree)
+//
+//	\param process the process, which must be in the tree
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::FairRemoveProcess(Process *process)
+{
+    std::multimap<Time, Process*>::iterator it;
+    for (it = fairTree.lower_bound(process->vruntime);
+	 it != fairTree.end() && it->second != process; it++)
+      ;
+    ASSERT(it != fairTree.end());
+    fairTree.erase(it);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ChangePriority
+/*! 	Change the priority of a thread. If the thread is ready, it
+//	moves to the run queue of its new priority.
+//
+//	\param thread the thread
+//	\param priority its new priority (PRIO_HIGHEST to PRIO_LOWEST)
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::ChangePriority(Thread *thread, int priority)
+{
+    int queue = RunQueue(thread);
+    bool ready = g_cfg->SchedPolicy != SCHED_FAIR
+      && readyList[queue]->Search(thread);
+
+    if (ready) {
+      readyList[queue]->RemoveItem(thread);
+      if (readyList[queue]->IsEmpty())
+	readyMask &= ~(1U << queue);
+    }
+    thread->priority = priority;
+    if (ready) {
+      queue = RunQueue(thread);
+      readyList[queue]->Append((void *)thread);
+      readyMask |= 1U << queue;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetPriority
+/*! 	Change the fixed priority of a thread. It keeps the priority it
+//	inherits from the waiters of its locks, if higher.
+//
+//	\param thread the thread
+//	\param priority its new priority (PRIO_HIGHEST to PRIO_LOWEST)
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::SetPriority(Thread *thread, int priority)
+{
+    IntStatus oldLevel = g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+    thread->base_priority = priority;
+    UpdatePriority(thread);
+    g_machine->interrupt->SetStatus(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::UpdatePriority
+/*! 	Priority inheritance, with fixed priorities: a thread runs at
+//	the highest of its own priority and the priorities of the threads
+//	waiting for the locks it holds. Called when a thread blocks on a
+//	lock, gets a lock, or releases one. When the priority of a thread
+//	blocked on a lock changes, the owner of that lock is updated in
+//	turn, so that a whole chain of blocked owners inherits it.
+//	Also accounts for the time spent with an inherited priority.
+//
+//	\param thread the thread
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::UpdatePriority(Thread *thread)
+{
+    IntStatus oldLevel = g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+    int priority = thread->base_priority;
+    if (g_cfg->SchedPolicy == SCHED_PRIORITY) {
+      for (ListElement<int> *e = thread->held_locks->getFirst();
+	   e != NULL; e = e->next) {
+	int inherited = ((Lock *)e->item)->WaitersPriority();
+	if (inherited < priority)
+	  priority = inherited;
+      }
+    }
+
+    bool boosted = priority < thread->base_priority;
+    if (boosted && !thread->boosted)
+      thread->boost_start = g_stats->getTotalTicks();
+    else if (!boosted && thread->boosted)
+      g_stats->incrBoostedTicks(g_stats->getTotalTicks() - thread->boost_start);
+    thread->boosted = boosted;
+
+    if (priority != thread->priority) {
+      DEBUG('t', (char *)"Priority of thread %s: %d -> %d\n",
+	    thread->GetName(), thread->priority, priority);
+      ChangePriority(thread, priority);
+      // Without lock handoff, a released lock has no owner until a
+      // woken waiter takes it: there is nobody to boost
+      if (thread->waiting_lock != NULL
+	  && thread->waiting_lock->getOwner() != NULL)
+	UpdatePriority(thread->waiting_lock->getOwner());
+    }
+    g_machine->interrupt->SetStatus(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetRealTime
+/*! 	Make a thread a periodic real-time thread. A job of the thread is
+//	released every period, must complete within deadline cycles and
+//	may use budget cycles of CPU time. The first job is released now.
+//	The thread is admitted only if the total utilization of the
+//	real-time threads stays below g_cfg->RealTimeUtilization percent,
+//	which guarantees that earliest deadline first meets all deadlines.
+//
+//	\param thread the thread (the current thread)
+//	\param period period of the thread, in cycles
+//	\param budget CPU time of a job (0 < budget <= deadline)
+//	\param deadline relative deadline of a job (deadline <= period)
+//	\return false if the thread is not admitted
+*/
+//----------------------------------------------------------------------
+bool
+Scheduler::SetRealTime(Thread *thread, Time period, Time budget, Time deadline)
+{
+    ASSERT(budget > 0 && budget <= deadline && deadline <= period);
+    double load = rtLoad + (double)budget / deadline;
+    if (thread->realtime)
+      load -= (double)thread->rt_budget / thread->rt_deadline;
+    if (load > g_cfg->RealTimeUtilization / 100.0) {
+      DEBUG('t', (char *)"Real-time thread %s rejected (load %f)\n",
+	    thread->GetName(), load);
+      return false;
+    }
+    rtLoad = load;
+    IntStatus oldLevel = g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+
+    Time now = g_stats->getTotalTicks();
+    thread->realtime = true;
+    thread->rt_period = period;
+    thread->rt_budget = budget;
+    thread->rt_deadline = deadline;
+    thread->rt_release = now;
+    thread->rt_abs_deadline = now + deadline;
+    thread->rt_job_cpu = thread->CpuTime();
+    thread->rt_throttled = false;
+    g_stats->incrRealTimeJobs();
+    UpdateTimer();
+    g_machine->interrupt->SetStatus(oldLevel);
+    return true;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::LeaveRealTime
+/*! 	Make a real-time thread a normal thread again, and release its
+//	share of the processor.
+//
+//	\param thread the thread
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::LeaveRealTime(Thread *thread)
+{
+    if (!thread->realtime)
+      return;
+    IntStatus oldLevel = g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+    rtLoad -= (double)thread->rt_budget / thread->rt_deadline;
+    if (rtLoad < 0) rtLoad = 0;
+    rtReadyList->RemoveItem(thread);
+    thread->realtime = false;
+    thread->rt_throttled = false;
+    g_machine->interrupt->SetStatus(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::WaitPeriod
+/*! 	End the current job of a real-time thread, and wait for the
+//	release of the next one. A job which completes after its deadline
+//	is counted as a deadline miss.
+//
+//	\param thread the thread (the current thread)
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::WaitPeriod(Thread *thread)
+{
+    ASSERT(thread == g_current_thread && thread->realtime);
+    IntStatus oldLevel = g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+    if (g_stats->getTotalTicks() > thread->rt_abs_deadline)
+      g_stats->incrDeadlineMisses();
+    if (!NextJob(thread))
+      thread->Yield();
+    g_machine->interrupt->SetStatus(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NextJob
+/*! 	Start the next job of a real-time thread. If its release date is
+//	not reached yet, the thread sleeps until then. Interrupts must be
+//	disabled.
+//
+//	\param thread the thread (the current thread)
+//	\return true if the thread slept, false if the job is already
+//		released (a late job starts at once)
+*/
+//----------------------------------------------------------------------
+bool
+Scheduler::NextJob(Thread *thread)
+{
+    ASSERT(g_machine->interrupt->GetStatus() == INTERRUPTS_OFF);
+    thread->rt_release += thread->rt_period;
+    thread->rt_abs_deadline = thread->rt_release + thread->rt_deadline;
+    thread->rt_job_cpu = thread->CpuTime();
+    thread->rt_throttled = false;
+    g_stats->incrRealTimeJobs();
+
+    if (thread->rt_release <= g_stats->getTotalTicks())
+      return false;
+    DEBUG('t', (char *)"Real-time thread %s waits for its release at %llu\n",
+	  thread->GetName(), thread->rt_release);
+    SleepUntil(thread->rt_release);
+    return true;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::CheckRealTime
+/*! 	Called by the timer interrupt handler. A real-time thread which
+//	used its whole budget is stopped until its next period (the job
+//	is counted as a budget overrun and a deadline miss), and a thread
+//	is preempted when a real-time thread with an earlier deadline is
+//	ready.
+//
+//	\param thread the running thread
+//	\return true if the running thread must yield the CPU
+*/
+//----------------------------------------------------------------------
+bool
+Scheduler::CheckRealTime(Thread *thread)
+{
+    if (thread->realtime && !thread->rt_throttled
+	&& thread->CpuTime() - thread->rt_job_cpu >= thread->rt_budget) {
+      DEBUG('t', (char *)"Real-time thread %s exceeded its budget\n",
+	    thread->GetName());
+      thread->rt_throttled = true;
+      g_stats->incrBudgetOverruns();
+      g_stats->incrDeadlineMisses();
+      return true;
+    }
+    if (rtReadyList->IsEmpty())
+      return false;
+
+    Time deadline;
+    Thread *first = (Thread *)rtReadyList->SortedRemove(&deadline);
+    rtReadyList->SortedInsert((void *)first, deadline);
+    return !thread->realtime || deadline < thread->rt_abs_deadline;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::AddTimer
+/*! 	Insert a timer in the kernel timer queue: func(arg) is called by
+//	the timer interrupt handler at the given date (rounded up to the
+//	next timer interrupt, which is exact in tickless mode), with
+//	interrupts disabled. func must not block.
+//
+//	\param when date of the timer, in cycles
+//	\param func the function to call
+//	\param arg the argument of the function
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::AddTimer(Time when, VoidFunctionPtr func, int64_t arg)
+{
+    IntStatus oldLevel = g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+    KernelTimer *timer = new KernelTimer;
+    timer->func = func;
+    timer->arg = arg;
+    timerQueue->SortedInsert((void *)timer, when);
+    UpdateTimer();
+    g_machine->interrupt->SetStatus(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::CancelTimer
+/*! 	Remove from the kernel timer queue the timers which would call
+//	func(arg).
+//
+//	\param func the function of the timers
+//	\param arg the argument of the function
+//	\return the date of the first removed timer, 0 if there was none
+*/
+//----------------------------------------------------------------------
+Time
+Scheduler::CancelTimer(VoidFunctionPtr func, int64_t arg)
+{
+    IntStatus oldLevel = g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+    ListTime *kept = new ListTime;
+    Time when, first = 0;
+    KernelTimer *timer;
+
+    while ((timer = (KernelTimer *)timerQueue->SortedRemove(&when)) != NULL) {
+      if (timer->func == func && timer->arg == arg) {
+	if (first == 0) first = when;
+	delete timer;
+      }
+      else
+	kept->SortedInsert((void *)timer, when);
+    }
+    delete timerQueue;
+    timerQueue = kept;
+    UpdateTimer();
+    g_machine->interrupt->SetStatus(oldLevel);
+    return first;
+}
+
+//----------------------------------------------------------------------
+// WakeUpThread
+/*! 	Kernel timer of a sleeping thread: put it back in the ready lists
+//
+//	\param arg the thread
+*/
+//----------------------------------------------------------------------
+static void
+WakeUpThread(int64_t arg)
+{
+    Thread *thread = (Thread *)arg;
+    DEBUG('t', (char *)"Waking up thread %s at %llu\n", thread->GetName(),
+	  g_stats->getTotalTicks());
+    g_scheduler->ReadyToRun(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SleepUntil
+/*! 	Put the current thread to sleep until a given date. It is woken
+//	up by a kernel timer (see AddTimer).
+//
+//	\param when date to wake up, in cycles
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::SleepUntil(Time when)
+{
+    IntStatus oldLevel = g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+    AddTimer(when, WakeUpThread, (int64_t)g_current_thread);
+    g_current_thread->Sleep();
+    g_machine->interrupt->SetStatus(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::RunTimers
+/*! 	Called by the timer interrupt handler: fire the kernel timers
+//	whose date has passed, in date order.
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::RunTimers()
+{
+    Time now = g_stats->getTotalTicks();
+    while (!timerQueue->IsEmpty() && timerQueue->getFirst()->key <= now) {
+      KernelTimer *timer = (KernelTimer *)timerQueue->Remove();
+      VoidFunctionPtr func = timer->func;
+      int64_t arg = timer->arg;
+      delete timer;
+      (*func)(arg);
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::UpdateTimer
+/*! 	Tickless mode: program the one-shot timer for the next event
+//	which needs it: the first timer of the kernel timer queue, the
+//	end of the budget of a running real-time thread, the preemption
+//	of the running thread by a ready real-time thread with an earlier
+//	deadline, or in time sharing mode the end of the quantum of the
+//	running thread when another thread is ready. When there is none
+//	(idle machine, or a single runnable thread), the timer is stopped.
+//	Called with interrupts disabled each time one of these changes.
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::UpdateTimer()
+{
+    if (!g_cfg->Tickless || g_timer == NULL)
+      return;
+
+    Time now = g_stats->getTotalTicks();
+    Time next = 0;
+    if (!timerQueue->IsEmpty())
+      next = timerQueue->getFirst()->key;
+
+    Thread *thread = g_current_thread;
+    if (thread != NULL && thread->on_cpu
+	&& g_machine->GetStatus() != IDLE_MODE) {
+      Time end = 0;       // 0: the running thread needs no interrupt
+      Time deadline;
+      if (!rtReadyList->IsEmpty()) {
+	Thread *first = (Thread *)rtReadyList->SortedRemove(&deadline);
+	rtReadyList->SortedInsert((void *)first, deadline);
+	if (!thread->realtime || deadline < thread->rt_abs_deadline)
+	  end = now + 1;
+      }
+      if (end == 0 && thread->realtime && !thread->rt_throttled) {
+	Time used = thread->CpuTime() - thread->rt_job_cpu;
+	end = now + 1 + (used < thread->rt_budget ? thread->rt_budget - used : 0);
+      }
+      else if (end == 0 && !thread->realtime && g_cfg->TimeSharing
+	       && HasReadyThreads())
+	end = thread->quantum_start + Quantum(thread);
+      if (end != 0 && (next == 0 || end < next))
+	next = end;
+    }
+    g_timer->SetDeadline(next);
+}
+
 //----------------------------------------------------------------------
 // Scheduler::SwitchTo
 /*! 	Dispatch the CPU to nextThread.  Save the state of the old thread,
@@ -97,20 +833,26 @@ Thread *oldThread = g_current_thread;
     DEBUG('t', (char *)"Switching from thread \"%s\" to thread \"%s\" time %llu\n",
 	  g_current_thread->GetName(), nextThread->GetName(),g_stats->getTotalTicks());
     
+    // Account for the CPU time used by the old thread, and start the
+    // quantum of the new one
+    oldThread->EndQuantum();
+    nextThread->StartQuantum();
+
     // Modify the current thread
     g_current_thread = nextThread;
+    UpdateTimer();
 
     // Save the context of old thread
     oldThread->SaveProcessorState();
-    oldThread->SaveSimulatorState();
 
     // Do the context switch if the two threads are different
     if (oldThread!=g_current_thread) {
+	g_stats->incrContextSwitches();
     	// Restore the state of the operating system from its
     	// kernelContext structure such that it goes on executing when
     	// it was last interrupted
     	nextThread->RestoreProcessorState();
-	nextThread->RestoreSimulatorState();
+	oldThread->SwitchSimulatorState(nextThread);
     }
 
     DEBUG('t', (char *)"Now in thread \"%s\" time %llu\n", g_current_thread->GetName(),g_stats->getTotalTicks());
@@ -119,7 +861,24 @@ Thread *oldThread = g_current_thread;
     // we need to delete its carcass.  Note we cannot delete the thread
     // before now (for example, in Thread::Finish()), because up to this
     // point, we were still running on the old thread's stack!
+    DeleteFinishedThread();
+}
 
+//----------------------------------------------------------------------
+// Scheduler::DeleteFinishedThread
+/*! 	Delete the thread which just finished (g_thread_to_be_destroyed),
+//	if we are no longer running on its stack.
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::DeleteFinishedThread()
+{
+    if (g_thread_to_be_destroyed != NULL
+	&& g_thread_to_be_destroyed != g_current_thread) {
+      Thread *carcass = g_thread_to_be_destroyed;
+      g_thread_to_be_destroyed = NULL;
+      delete carcass;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -131,7 +890,52 @@ Thread *oldThread = g_current_thread;
 void
 Scheduler::Print()
 {
-    printf("Ready list contents: [");
-    readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
-    printf("]\n");
+    if (!rtReadyList->IsEmpty()) {
+      printf("Real-time ready list contents: [");
+      rtReadyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+      printf("]\n");
+    }
+    std::map<Process*, ThreadTree>::iterator p;
+    for (p = fairThreads.begin(); p != fairThreads.end(); p++) {
+      printf("Ready threads of process %s (vruntime %llu): [",
+	     p->first->getName(), (unsigned long long)p->first->vruntime);
+      for (ThreadTree::iterator t = p->second.begin(); t != p->second.end(); t++)
+	printf(" %s", t->second->GetName());
+      printf(" ]\n");
+    }
+    for (int i = 0; i < NB_RUN_QUEUES; i++) {
+      if (readyList[i]->IsEmpty()) continue;
+      printf("Ready list %d contents: [", i);
+      readyList[i]->Mapcar((VoidFunctionPtr) ThreadPrint);
+      printf("]\n");
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::PrintStats
+/*! 	Print the statistics of the multilevel feedback queue, when
+//	Nachos halts.
+*/
+//----------------------------------------------------------------------
+void
+Scheduler::PrintStats()
+{
+    if (g_cfg->SchedPolicy == SCHED_FAIR) {
+      printf("   Scheduler : fair share, %d dispatches\n", levelDispatches[0]);
+      return;
+    }
+    if (g_cfg->SchedPolicy == SCHED_PRIORITY) {
+      printf("   Scheduler : fixed priorities\n");
+      for (int i = 0; i < NB_RUN_QUEUES; i++)
+	if (levelDispatches[i] != 0)
+	  printf("      priority %d : %d dispatches, %llu cycles\n",
+		 i, levelDispatches[i], (unsigned long long)levelTicks[i]);
+      return;
+    }
+    printf("   Scheduler : %d boosts, %d demotions, %d promotions\n",
+	   nbBoosts, nbDemotions, nbPromotions);
+    for (int i = 0; i < NB_PRIORITY_LEVELS; i++)
+      printf("      level %d (quantum %llu cycles) : %d dispatches, %llu cycles\n",
+	     i, (unsigned long long)g_cfg->Quantum << i, levelDispatches[i],
+	     (unsigned long long)levelTicks[i]);
 }
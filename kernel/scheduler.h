@@ -6,6 +6,43 @@
    the data structures and operations needed to keep track of which 
    thread is running, and which threads are ready but not running.
 
+   Ready threads are kept in one FIFO run queue per priority, and a
+   bitmap of the non-empty run queues gives the highest priority ready
+   thread in constant time. Two policies use these run queues:
+
+   - multilevel feedback queue (SCHED_MLFQ): a thread which uses its
+   whole quantum moves down one level (with a quantum twice as long),
+   a thread which blocks before the end of its quantum moves up one
+   level, and all threads are periodically moved back to the highest
+   level so that CPU-bound threads do not starve.
+
+   - fixed priorities (SCHED_PRIORITY): the run queue of a thread is
+   its priority, set by the SetPriority system call. A thread which
+   holds a Lock runs at least at the priority of the threads waiting
+   for it (priority inheritance, along chains of blocked owners).
+
+   The fair share policy (SCHED_FAIR) does not use the run queues.
+   Processes with ready threads are kept in a balanced tree ordered by
+   their virtual runtime (CPU time divided by a weight given by their
+   nice value), and the ready threads of each process in a tree
+   ordered by their own CPU time. The next thread is the one which ran
+   the least in the process which ran the least, so that processes
+   share the CPU in proportion to their weight whatever their number
+   of threads.
+
+   Whatever the policy, periodic real-time threads (see SetRealTime)
+   run before all other threads, by earliest deadline first. A
+   real-time thread is admitted only if the total utilization
+   (budget/deadline) of the real-time threads stays below
+   g_cfg->RealTimeUtilization percent, and a job which exceeds its
+   budget is stopped until the next period, so that real-time threads
+   cannot starve the others.
+
+   The scheduler also keeps the kernel timer queue: functions to call
+   at a given date, fired by the timer interrupt handler. Sleeping
+   threads, real-time releases and the alarms of the user programs
+   (see the Sleep and Alarm system calls) use it.
+
    Copyright (c) 1992-1993 The Regents of the University of California.
    All rights reserved.  See copyright.h for copyright notice and limitation 
    of liability and disclaimer of warranty provisions.
@@ -18,16 +55,34 @@
 
 #include "kernel/copyright.h"
 #include "utility/list.h"
+#include "utility/utility.h"
+#include <map>
+
+//! Number of priority levels of the multilevel feedback queue (0 is the highest)
+#define NB_PRIORITY_LEVELS 4
+
+//! Number of run queues (one per fixed priority, PRIO_HIGHEST to PRIO_LOWEST)
+#define NB_RUN_QUEUES 32
+
+//! Weight of a process of nice value 0 in the fair share scheduler
+#define NICE_0_WEIGHT 1024
 
 class Thread;
+class Process;
+
+//! A timer of the kernel timer queue: func(arg) is called at its date
+struct KernelTimer {
+  VoidFunctionPtr func;
+  int64_t arg;
+};
 
 class Scheduler {
 public:
   
-  //! Constructor. Initializes list of ready threads.  
+  //! Constructor. Initializes lists of ready threads.  
   Scheduler();
    
-  //! Destructor. De-allocates the ready list. 
+  //! Destructor. De-allocates the ready lists. 
   ~Scheduler();
     			
   //! Inserts a thread in the ready list
@@ -35,16 +90,125 @@ public:
     
   //! Dequeue first thread of the ready list, if any, and return thread. 
   Thread* FindNextToRun();
+
+  //! Dequeue a given ready thread, for a directed yield
+  bool RemoveReady(Thread *thread);
     		
   //! Causes a context switch to nextThread
   void SwitchTo(Thread* nextThread);
+
+  //! Deletes the thread which just finished, once off its stack
+  void DeleteFinishedThread();
     
-  //! Print contents of ready list.  
+  //! Quantum of a thread, which depends on its priority level
+  Time Quantum(Thread *thread);
+
+  //! Called when a thread has used its whole quantum (moves it down)
+  void QuantumExpired(Thread *thread);
+
+  //! Account for the CPU time used by a thread at its priority level
+  void AccountCpuTime(Thread *thread, Time ticks);
+
+  //! Change the fixed priority of a thread
+  void SetPriority(Thread *thread, int priority);
+
+  //! Priority inheritance: recompute the priority of a lock owner
+  void UpdatePriority(Thread *thread);
+
+  //! Make a thread a periodic real-time thread (admission test)
+  bool SetRealTime(Thread *thread, Time period, Time budget, Time deadline);
+
+  //! Make a real-time thread a normal thread again
+  void LeaveRealTime(Thread *thread);
+
+  //! End the current job of a real-time thread and wait for the next one
+  void WaitPeriod(Thread *thread);
+
+  //! Start the next job of a real-time thread, sleeping until its release
+  bool NextJob(Thread *thread);
+
+  //! Check the budget and deadline of the running thread (timer interrupt)
+  bool CheckRealTime(Thread *thread);
+
+  //! Call a function at a given date (kernel timer queue)
+  void AddTimer(Time when, VoidFunctionPtr func, int64_t arg);
+
+  //! Remove the timers of the queue which would call func(arg)
+  Time CancelTimer(VoidFunctionPtr func, int64_t arg);
+
+  //! Put the current thread to sleep until a given date
+  void SleepUntil(Time when);
+
+  //! Fire the timers whose date has passed (timer interrupt)
+  void RunTimers();
+
+  //! True if some timer is pending
+  bool HasTimers() { return !timerQueue->IsEmpty(); }
+
+  //! Tickless mode: program the timer for the next scheduling event
+  void UpdateTimer();
+
+  //! Weight of a process in the fair share scheduler
+  static int NiceToWeight(int nice);
+
+  //! Print contents of ready lists.  
   void Print();
 
+  //! Print the per-level statistics
+  void PrintStats();
+
 protected:  
-  //! Queue of threads that are ready to run, but not running.
-  Listint *readyList;
+  //! Queues of threads that are ready to run, but not running (one per priority)
+  Listint *readyList[NB_RUN_QUEUES];
+
+  //! Bit i is set if readyList[i] is not empty
+  uint32_t readyMask;
+
+  //! Ready real-time threads, by absolute deadline
+  ListTime *rtReadyList;
+
+  //! Kernel timers (KernelTimer), by date
+  ListTime *timerQueue;
+
+  //! Sum of the utilizations (budget/deadline) of the real-time threads
+  double rtLoad;
+
+  //! Run queue of a thread, depending on the scheduling policy
+  int RunQueue(Thread *thread);
+
+  //! Change the priority of a thread, moving it if it is ready
+  void ChangePriority(Thread *thread, int priority);
+
+  //! True if some thread is ready (whatever the policy)
+  bool HasReadyThreads()
+    { return readyMask != 0 || !fairTree.empty() || !rtReadyList->IsEmpty(); }
+
+  //! Fair share scheduler: ready threads of a process, by CPU time
+  typedef std::multimap<Time, Thread*> ThreadTree;
+
+  //! Fair share scheduler: processes with ready threads, by virtual runtime
+  std::multimap<Time, Process*> fairTree;
+
+  //! Fair share scheduler: ready threads of each process of fairTree
+  std::map<Process*, ThreadTree> fairThreads;
+
+  //! Fair share scheduler: virtual runtime of the last chosen process
+  Time minVruntime;
+
+  void FairEnqueue(Thread *thread);
+  Thread *FairDequeue();
+  void FairRemoveProcess(Process *process);
+
+  //! Move all threads back to the highest priority level
+  void Boost();
+  static void ResetLevel(int64_t thread);
+
+  Time lastBoost;                            //!< Date of the last boost
+  int nbBoosts;                              //!< Number of boosts
+  int nbDemotions;                           //!< Number of threads moved down
+  int nbPromotions;                          //!< Number of threads moved up
+  int levelDispatches[NB_RUN_QUEUES];        //!< Times a thread of each run queue got the CPU
+  Time levelTicks[NB_RUN_QUEUES];            //!< CPU time used by the threads of each run queue
 };
 
 #endif // SCHEDULER_H
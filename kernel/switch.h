@@ -0,0 +1,38 @@
+/*! \file switch.h
+    \brief Low-level context switch between kernel threads
+
+   On x86-64 and aarch64 (ELF), the stacks of the kernel threads are
+   switched by a short assembly routine (see switch.s) which saves
+   only the callee-saved registers on the stack of the old thread,
+   and restores them from the stack of the new one. Other hosts use
+   swapcontext, which also saves the signal mask (a system call on
+   each switch).
+
+   Copyright (c) 1992-1993 The Regents of the University of California.
+   All rights reserved.  See copyright.h for copyright notice and limitation
+   of liability and disclaimer of warranty provisions.
+*/
+
+#ifndef SWITCH_H
+#define SWITCH_H
+
+#include "kernel/copyright.h"
+
+#if (defined(__x86_64__) || defined(__aarch64__)) && defined(__ELF__)
+#define FAST_CONTEXT_SWITCH
+#endif
+
+#ifdef FAST_CONTEXT_SWITCH
+extern "C" {
+  /*! Save the callee-saved registers on the current stack, store the
+   * stack pointer in *old_sp, and resume the thread whose stack
+   * pointer is new_sp. Returns when another thread switches back. */
+  void ContextSwitch(void **old_sp, void *new_sp);
+}
+
+/*! Prepare a stack such that the first ContextSwitch to the returned
+ * stack pointer calls func (which must not return) */
+void *ContextInit(void *stack, unsigned long stack_size, void (*func)(void));
+#endif
+
+#endif // SWITCH_H
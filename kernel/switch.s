@@ -0,0 +1,83 @@
+/* switch.s
+ *	Machine dependent context switch routine (host code).
+ *
+ *	ContextSwitch(void **old_sp, void *new_sp)
+ *
+ *	Save the callee-saved registers of the calling thread on its
+ *	stack, store its stack pointer in *old_sp, then load new_sp and
+ *	restore the registers of the new thread, which returns from its
+ *	own call to ContextSwitch (or starts, see ContextInit in
+ *	thread.cc). Caller-saved registers are already saved by the
+ *	compiler around the call, and the signal mask is left alone.
+ *
+ *	Keep the frame layout in sync with ContextInit.
+ *
+ *  Copyright (c) 1992-1993 The Regents of the University of California.
+ *  All rights reserved.  See copyright.h for copyright notice and limitation
+ *  of liability and disclaimer of warranty provisions.
+ */
+
+#if defined(__x86_64__) && defined(__ELF__)
+
+/* Frame: r15 r14 r13 r12 rbx rbp <return address> */
+	.text
+	.globl	ContextSwitch
+	.type	ContextSwitch, @function
+ContextSwitch:
+	pushq	%rbp
+	pushq	%rbx
+	pushq	%r12
+	pushq	%r13
+	pushq	%r14
+	pushq	%r15
+	movq	%rsp, (%rdi)		/* *old_sp = sp */
+	movq	%rsi, %rsp		/* sp = new_sp */
+	popq	%r15
+	popq	%r14
+	popq	%r13
+	popq	%r12
+	popq	%rbx
+	popq	%rbp
+	ret
+	.size	ContextSwitch, .-ContextSwitch
+
+#elif defined(__aarch64__) && defined(__ELF__)
+
+/* Frame (160 bytes): x19-x28, x29 (fp), x30 (lr), d8-d15 */
+	.text
+	.globl	ContextSwitch
+	.type	ContextSwitch, %function
+ContextSwitch:
+	sub	sp, sp, #160
+	stp	x19, x20, [sp, #0]
+	stp	x21, x22, [sp, #16]
+	stp	x23, x24, [sp, #32]
+	stp	x25, x26, [sp, #48]
+	stp	x27, x28, [sp, #64]
+	stp	x29, x30, [sp, #80]
+	stp	d8, d9, [sp, #96]
+	stp	d10, d11, [sp, #112]
+	stp	d12, d13, [sp, #128]
+	stp	d14, d15, [sp, #144]
+	mov	x2, sp
+	str	x2, [x0]		/* *old_sp = sp */
+	mov	sp, x1			/* sp = new_sp */
+	ldp	x19, x20, [sp, #0]
+	ldp	x21, x22, [sp, #16]
+	ldp	x23, x24, [sp, #32]
+	ldp	x25, x26, [sp, #48]
+	ldp	x27, x28, [sp, #64]
+	ldp	x29, x30, [sp, #80]
+	ldp	d8, d9, [sp, #96]
+	ldp	d10, d11, [sp, #112]
+	ldp	d12, d13, [sp, #128]
+	ldp	d14, d15, [sp, #144]
+	add	sp, sp, #160
+	ret
+	.size	ContextSwitch, .-ContextSwitch
+
+#endif
+
+#if defined(__ELF__)
+	.section .note.GNU-stack,"",%progbits
+#endif
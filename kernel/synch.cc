@@ -25,6 +25,7 @@
 #include "kernel/system.h"
 #include "kernel/scheduler.h"
 #include "kernel/synch.h"
+#include "userlib/syscall.h"
 
 //----------------------------------------------------------------------
 // Semaphore::Semaphore
@@ -122,6 +123,8 @@ Semaphore::V() {
       Thread* thread_R2R = (Thread*)(this -> queue -> Remove());
       g_scheduler -> ReadyToRun(thread_R2R);
     }
+    else
+      NotifyEvent();
     g_machine -> interrupt -> SetStatus(old_status);
   #endif
   #ifndef ETUDIANTS_TP
@@ -150,16 +153,85 @@ Lock::Lock(char* debugName) {
 //----------------------------------------------------------------------
 // Lock::~Lock
 /*! 	De-allocate lock, when no longer needed. Assumes that no thread
-//      is waiting on the lock.
+//      is waiting on the lock. A lock destroyed while it is held is
+//      removed from the locks of its owner.
 */
 //----------------------------------------------------------------------
 Lock::~Lock() {
   type = INVALID_TYPE;
   ASSERT(sleepqueue->IsEmpty());
+  IntStatus old_status = g_machine -> interrupt -> GetStatus();
+  g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
+  if (this -> owner != NULL && this -> owner -> held_locks -> Search(this)) {
+    this -> owner -> held_locks -> RemoveItem(this);
+    g_scheduler -> UpdatePriority(this -> owner);
+  }
+  g_machine -> interrupt -> SetStatus(old_status);
   delete [] name;
   delete sleepqueue;
 }
 
+//----------------------------------------------------------------------
+// Lock::AddWaiter
+/*! 	Put a thread in the queue of the busy lock. With fixed
+//	priorities, the owner inherits the priority of the thread (see
+//	Scheduler::UpdatePriority). Interrupts must be disabled.
+//
+//  \param thread the waiting thread
+*/
+//----------------------------------------------------------------------
+void Lock::AddWaiter(Thread *thread) {
+  this -> sleepqueue -> Append(thread);
+  thread -> waiting_lock = this;
+  if (g_cfg -> SchedPolicy == SCHED_PRIORITY
+      && this -> owner -> GetPriority() > thread -> GetPriority())
+    g_stats -> incrPriorityInversions();
+  g_scheduler -> UpdatePriority(this -> owner);
+}
+
+//----------------------------------------------------------------------
+// Lock::RemoveWaiter
+/*! 	Take the next owner out of the queue of the lock: the first
+//	waiter, or with fixed priorities the first waiter of the highest
+//	priority. The order of the other waiters is kept. Interrupts must
+//	be disabled.
+//
+//  \return the thread
+*/
+//----------------------------------------------------------------------
+Thread *Lock::RemoveWaiter() {
+  Thread *next = (Thread *)(this -> sleepqueue -> getFirst() -> item);
+  int nb_waiters = 0;
+  for (ListElement<int> *e = this -> sleepqueue -> getFirst(); e != NULL; e = e -> next) {
+    if (g_cfg -> SchedPolicy == SCHED_PRIORITY
+        && ((Thread *)e -> item) -> GetPriority() < next -> GetPriority())
+      next = (Thread *)e -> item;
+    nb_waiters++;
+  }
+  for (int i = 0; i < nb_waiters; i++) {
+    Thread *t = (Thread *)(this -> sleepqueue -> Remove());
+    if (t != next)
+      this -> sleepqueue -> Append(t);
+  }
+  next -> waiting_lock = NULL;
+  return next;
+}
+
+//----------------------------------------------------------------------
+// Lock::GiveTo
+/*! 	Make a thread the owner of the lock. Interrupts must be disabled.
+//
+//  \param thread the new owner
+*/
+//----------------------------------------------------------------------
+void Lock::GiveTo(Thread *thread) {
+  this -> owner = thread;
+  this -> free = false;
+  thread -> held_locks -> Append(this);
+  // The new owner inherits from the remaining waiters
+  g_scheduler -> UpdatePriority(thread);
+}
+
 //----------------------------------------------------------------------
 // Lock::Acquire
 /*! 	Wait until the lock become free.  Checking the
@@ -169,6 +241,10 @@ Lock::~Lock() {
 //
 //	Note that Thread::Sleep assumes that interrupts are disabled
 //	when it is called.
+//
+//	In handoff mode (g_cfg->LockHandoff), a waiter wakes up owning
+//	the lock. Otherwise it competes for it again with the threads
+//	which called Acquire in the meantime.
 */
 //----------------------------------------------------------------------
 void Lock::Acquire() {
@@ -177,15 +253,13 @@ void Lock::Acquire() {
     g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
 
     DEBUG('s', (char *)"[%s] Acquire(%s) --> %d (avant Acquire)\n", g_current_thread -> GetName(), this -> name, this -> free);
-    // If the lock is free, the current thread takes the lock
-    // Else we put it in the sleepqueue
-    if (this -> free) {
-      this -> owner = g_current_thread;
-      this -> free = false;
-    } else {
-      this -> sleepqueue -> Append(g_current_thread);
+    // Sleep while the lock is busy, unless it was handed to us
+    while (!this -> free && this -> owner != g_current_thread) {
+      AddWaiter(g_current_thread);
       g_current_thread -> Sleep();
     }
+    if (this -> owner != g_current_thread)
+      GiveTo(g_current_thread);
 
     DEBUG('s', (char *)"[%s] Acquire(%s) --> %d (après Acquire)\n", g_current_thread -> GetName(), this -> name, this -> free);
     g_machine -> interrupt -> SetStatus(old_status);
@@ -203,6 +277,10 @@ void Lock::Acquire() {
 //	As with Acquire, this operation must be atomic, so we need to disable
 //	interrupts.  Scheduler::ReadyToRun() assumes that threads
 //	are disabled when it is called.
+//
+//	In handoff mode, the lock goes directly to the waiter, which
+//	does not have to check it again. The releasing thread gives back
+//	the priority it inherited through this lock.
 */
 //----------------------------------------------------------------------
 void Lock::Release() {
@@ -211,17 +289,21 @@ void Lock::Release() {
     g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
 
     DEBUG('s', (char *)"[%s] Release(%s) --> %d (avant Release)\n", g_current_thread -> GetName(), this -> name, this -> free);
-    // If the sleepqueue is empty, we reset to the initial values.
-    // Else the lock is acquired to the first sleeping thread
-    if (this -> sleepqueue -> IsEmpty()) {
-      this -> owner = NULL;
-      this -> free = true;
-    } else {
-      Thread* thread_R2R = (Thread*)(this -> sleepqueue -> Remove());
-      this -> owner = thread_R2R;
-      this -> free = false;
+    Thread *releaser = this -> owner;
+    if (releaser != NULL)
+      releaser -> held_locks -> RemoveItem(this);
+    this -> owner = NULL;
+    this -> free = true;
+    if (!this -> sleepqueue -> IsEmpty()) {
+      Thread* thread_R2R = RemoveWaiter();
+      if (g_cfg -> LockHandoff) {
+        GiveTo(thread_R2R);
+        g_stats -> incrLockHandoffs();
+      }
       g_scheduler -> ReadyToRun(thread_R2R);
     }
+    if (releaser != NULL)
+      g_scheduler -> UpdatePriority(releaser);
 
     DEBUG('s', (char *)"[%s] Release(%s) --> %d (après Release)\n", g_current_thread -> GetName(), this -> name, this -> free);
     g_machine -> interrupt -> SetStatus(old_status);
@@ -232,6 +314,28 @@ void Lock::Release() {
   #endif
 }
 
+//----------------------------------------------------------------------
+// Lock::Reacquire
+/*! 	Wait morphing: make a thread signaled on a condition variable
+//	acquire the lock again without running. It gets the lock at once
+//	if the lock is free, and is woken up; otherwise it moves to the
+//	queue of the lock, and will wake up owning it. Interrupts must be
+//	disabled.
+//
+//  \param thread the signaled thread
+*/
+//----------------------------------------------------------------------
+void Lock::Reacquire(Thread *thread) {
+  if (this -> free) {
+    GiveTo(thread);
+    g_scheduler -> ReadyToRun(thread);
+  }
+  else {
+    AddWaiter(thread);
+    g_stats -> incrWaitMorphs();
+  }
+}
+
 //----------------------------------------------------------------------
 // Lock::isHeldByCurrentThread
 /*! To check if current thread hold the lock
@@ -239,6 +343,20 @@ void Lock::Release() {
 //----------------------------------------------------------------------
 bool Lock::isHeldByCurrentThread() {return (g_current_thread == owner);}
 
+//----------------------------------------------------------------------
+// Lock::WaitersPriority
+/*! \return the highest priority of the threads waiting for the lock,
+//  PRIO_LOWEST if there is none
+*/
+//----------------------------------------------------------------------
+int Lock::WaitersPriority() {
+  int priority = PRIO_LOWEST;
+  for (ListElement<int> *e = sleepqueue -> getFirst(); e != NULL; e = e -> next)
+    if (((Thread *)e -> item) -> GetPriority() < priority)
+      priority = ((Thread *)e -> item) -> GetPriority();
+  return priority;
+}
+
 //----------------------------------------------------------------------
 // Condition::Condition
 /*! 	Initializes a Condition, so that it can be used for synchronization.
@@ -250,6 +368,7 @@ Condition::Condition(char* debugName) {
   name = new char[strlen(debugName)+1];
   strcpy(name,debugName);
   waitqueue = new Listint;
+  lock = NULL;
   type = CONDITION_TYPE;
 }
 
@@ -266,18 +385,48 @@ Condition::~Condition() {
   delete waitqueue;
 }
 
+//----------------------------------------------------------------------
+// Condition::WakeUp
+/*! Wake up a thread taken out of the wait queue. If it waits with a
+//  lock, in handoff mode it moves directly to the queue of the lock
+//  (see Lock::Reacquire) instead of waking up to compete for it.
+//
+//  \param thread the thread
+*/
+//----------------------------------------------------------------------
+void Condition::WakeUp(Thread *thread) {
+  if (this -> lock != NULL && g_cfg -> LockHandoff)
+    this -> lock -> Reacquire(thread);
+  else
+    g_scheduler -> ReadyToRun(thread);
+}
+
 //----------------------------------------------------------------------
 // Condition::Wait
 /*! Block the calling thread (put it in the wait queue).
 //  This operation must be atomic, so we need to disable interrupts.
+//
+//  \param lock if not NULL, a lock held by the calling thread, which
+//         is released while it waits and held again when it returns.
+//         All the waiters of a condition must use the same lock
+//         (see CanWaitWith).
 */
 //----------------------------------------------------------------------
-void Condition::Wait() {
+void Condition::Wait(Lock *lock) {
   #ifdef ETUDIANTS_TP
     IntStatus old_status = g_machine -> interrupt -> GetStatus();
     g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
+    ASSERT(CanWaitWith(lock));
+    this -> lock = lock;
     this -> waitqueue -> Append(g_current_thread);
+    if (lock != NULL) {
+      ASSERT(lock -> isHeldByCurrentThread());
+      lock -> Release();
+    }
     g_current_thread -> Sleep();
+    // With wait morphing, the thread already holds the lock here
+    if (lock != NULL)
+      lock -> Acquire();
     g_machine -> interrupt -> SetStatus(old_status);
   #endif
   #ifndef ETUDIANTS_TP
@@ -299,7 +448,7 @@ void Condition::Signal() {
     g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
     if (!this -> waitqueue -> IsEmpty()) {
       Thread* thread_R2R = (Thread*)(this -> waitqueue -> Remove());
-      g_scheduler -> ReadyToRun(thread_R2R);
+      WakeUp(thread_R2R);
     }
     g_machine -> interrupt -> SetStatus(old_status);
   #endif
@@ -321,7 +470,7 @@ void Condition::Broadcast() {
     g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
     while (!this -> waitqueue -> IsEmpty()) {
       Thread* thread_R2R = (Thread*)(this -> waitqueue -> Remove());
-      g_scheduler -> ReadyToRun(thread_R2R);
+      WakeUp(thread_R2R);
     }
     g_machine -> interrupt -> SetStatus(old_status);
   #endif
@@ -330,3 +479,234 @@ void Condition::Broadcast() {
     exit(-1);
   #endif
 }
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+/*! 	Initialize a reader-writer lock, initially free.
+//
+//  \param debugName is an arbitrary name, useful for debugging.
+//  \param writerPreference if true, a waiting writer blocks new readers
+*/
+//----------------------------------------------------------------------
+RWLock::RWLock(char* debugName, bool writerPreference) {
+  name = new char[strlen(debugName)+1];
+  strcpy(name,debugName);
+  writer_preference = writerPreference;
+  nb_readers = 0;
+  readers = new Listint;
+  writer = NULL;
+  readqueue = new Listint;
+  writequeue = new Listint;
+  type = RWLOCK_TYPE;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+/*! 	De-allocate the lock, when no longer needed. Assumes that no
+//      thread is waiting on the lock.
+*/
+//----------------------------------------------------------------------
+RWLock::~RWLock() {
+  type = INVALID_TYPE;
+  ASSERT(readqueue->IsEmpty() && writequeue->IsEmpty());
+  delete [] name;
+  delete readers;
+  delete readqueue;
+  delete writequeue;
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead
+/*! 	Acquire the lock as a reader. A blocked reader is woken up by
+//	Release when the lock is handed over to it, so it does not have
+//	to check the lock again.
+*/
+//----------------------------------------------------------------------
+void RWLock::AcquireRead() {
+  IntStatus old_status = g_machine -> interrupt -> GetStatus();
+  g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
+
+  DEBUG('s', (char *)"[%s] AcquireRead(%s) --> %d readers\n", g_current_thread -> GetName(), this -> name, this -> nb_readers);
+  if (this -> writer != NULL
+      || (this -> writer_preference && !this -> writequeue -> IsEmpty())) {
+    g_stats -> incrRWLockWaits(false);
+    this -> readqueue -> Append(g_current_thread);
+    g_current_thread -> Sleep();
+  }
+  else {
+    this -> nb_readers++;
+    this -> readers -> Append(g_current_thread);
+  }
+
+  g_machine -> interrupt -> SetStatus(old_status);
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite
+/*! 	Acquire the lock as the writer. As for the readers, a blocked
+//	writer wakes up owning the lock.
+*/
+//----------------------------------------------------------------------
+void RWLock::AcquireWrite() {
+  IntStatus old_status = g_machine -> interrupt -> GetStatus();
+  g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
+
+  DEBUG('s', (char *)"[%s] AcquireWrite(%s) --> %d readers\n", g_current_thread -> GetName(), this -> name, this -> nb_readers);
+  if (this -> writer != NULL || this -> nb_readers > 0) {
+    g_stats -> incrRWLockWaits(true);
+    this -> writequeue -> Append(g_current_thread);
+    g_current_thread -> Sleep();
+  }
+  else
+    this -> writer = g_current_thread;
+
+  g_machine -> interrupt -> SetStatus(old_status);
+}
+
+//----------------------------------------------------------------------
+// RWLock::Release
+/*! 	Release the lock held by the current thread. When the lock
+//	becomes free, it is handed over to the first waiting writer, or
+//	to all the waiting readers: the readers go first, unless the lock
+//	gives the preference to the writers.
+*/
+//----------------------------------------------------------------------
+void RWLock::Release() {
+  IntStatus old_status = g_machine -> interrupt -> GetStatus();
+  g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
+
+  DEBUG('s', (char *)"[%s] Release(%s) --> %d readers\n", g_current_thread -> GetName(), this -> name, this -> nb_readers);
+  ASSERT(isHeldByCurrentThread());
+  if (this -> writer == g_current_thread)
+    this -> writer = NULL;
+  else {
+    this -> nb_readers--;
+    this -> readers -> RemoveItem(g_current_thread);
+  }
+
+  if (this -> writer == NULL && this -> nb_readers == 0) {
+    if (!this -> writequeue -> IsEmpty()
+        && (this -> writer_preference || this -> readqueue -> IsEmpty())) {
+      this -> writer = (Thread *)(this -> writequeue -> Remove());
+      g_scheduler -> ReadyToRun(this -> writer);
+    }
+    else
+      while (!this -> readqueue -> IsEmpty()) {
+        Thread *reader = (Thread *)(this -> readqueue -> Remove());
+        this -> nb_readers++;
+        this -> readers -> Append(reader);
+        g_scheduler -> ReadyToRun(reader);
+      }
+  }
+
+  g_machine -> interrupt -> SetStatus(old_status);
+}
+
+//----------------------------------------------------------------------
+// Barrier::Barrier
+/*! 	Initialize a barrier.
+//
+//  \param debugName is an arbitrary name, useful for debugging.
+//  \param nbParties number of threads which wait for each other
+*/
+//----------------------------------------------------------------------
+Barrier::Barrier(char* debugName, int nbParties) {
+  ASSERT(nbParties > 0);
+  name = new char[strlen(debugName)+1];
+  strcpy(name,debugName);
+  nb_parties = nbParties;
+  nb_arrived = 0;
+  waitqueue = new Listint;
+  type = BARRIER_TYPE;
+}
+
+//----------------------------------------------------------------------
+// Barrier::~Barrier
+/*! 	De-allocate the barrier, when no longer needed. Assumes that no
+//      thread is waiting on the barrier.
+*/
+//----------------------------------------------------------------------
+Barrier::~Barrier() {
+  type = INVALID_TYPE;
+  ASSERT(waitqueue->IsEmpty());
+  delete [] name;
+  delete waitqueue;
+}
+
+//----------------------------------------------------------------------
+// Barrier::Wait
+/*! 	Block the calling thread until all the parties have arrived.
+//	The last one wakes up the others and starts a new round.
+//
+//  \return true in the last thread of the round, false in the others
+*/
+//----------------------------------------------------------------------
+bool Barrier::Wait() {
+  IntStatus old_status = g_machine -> interrupt -> GetStatus();
+  g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
+  bool last = (++this -> nb_arrived == this -> nb_parties);
+
+  DEBUG('s', (char *)"[%s] Wait(%s) --> %d/%d\n", g_current_thread -> GetName(), this -> name, this -> nb_arrived, this -> nb_parties);
+  if (last) {
+    this -> nb_arrived = 0;
+    while (!this -> waitqueue -> IsEmpty())
+      g_scheduler -> ReadyToRun((Thread *)(this -> waitqueue -> Remove()));
+    g_stats -> incrBarrierRounds();
+  }
+  else {
+    g_stats -> incrBarrierWaits();
+    this -> waitqueue -> Append(g_current_thread);
+    g_current_thread -> Sleep();
+  }
+
+  g_machine -> interrupt -> SetStatus(old_status);
+  return last;
+}
+
+//! Threads sleeping in WaitEvent
+static Listint event_waiters;
+
+//----------------------------------------------------------------------
+// EventTimeout
+/*! 	Kernel timer of a thread sleeping in WaitEvent: wake it up, unless
+//	NotifyEvent already did.
+//
+//	\param arg the thread
+*/
+//----------------------------------------------------------------------
+static void EventTimeout(int64_t arg) {
+  Thread *thread = (Thread *)arg;
+  if (event_waiters.Search(thread)) {
+    event_waiters.RemoveItem(thread);
+    g_scheduler -> ReadyToRun(thread);
+  }
+}
+
+//----------------------------------------------------------------------
+// WaitEvent
+/*! 	Put the current thread to sleep until the next call to
+//	NotifyEvent, or until a date. Interrupts must be disabled.
+//
+//	\param deadline date to wake up at the latest, in cycles (0: none)
+*/
+//----------------------------------------------------------------------
+void WaitEvent(Time deadline) {
+  ASSERT(g_machine -> interrupt -> GetStatus() == INTERRUPTS_OFF);
+  if (deadline != 0)
+    g_scheduler -> AddTimer(deadline, EventTimeout, (int64_t)g_current_thread);
+  event_waiters.Append(g_current_thread);
+  g_current_thread -> Sleep();
+  if (deadline != 0)
+    g_scheduler -> CancelTimer(EventTimeout, (int64_t)g_current_thread);
+}
+
+//----------------------------------------------------------------------
+// NotifyEvent
+/*! 	Wake up all the threads sleeping in WaitEvent, so that they
+//	check again the objects they wait for. Interrupts must be disabled.
+*/
+//----------------------------------------------------------------------
+void NotifyEvent() {
+  while (!event_waiters.IsEmpty())
+    g_scheduler -> ReadyToRun((Thread *)event_waiters.Remove());
+}
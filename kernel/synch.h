@@ -1,9 +1,10 @@
 /*! \file synch.h 
 	\brief Data structures for synchronizing threads.
 
-	Three kinds of synchronization are defined here: semaphores,
-	locks, and condition variables. Part or all of them are to be
-	implemented as part of the first assignment.
+	Five kinds of synchronization are defined here: semaphores,
+	locks, condition variables, reader-writer locks and barriers.
+	Part or all of them are to be implemented as part of the first
+	assignment.
 
 	Note that all the synchronization objects take a "name" as
 	part of the initialization.  This is solely for debugging purposes.
@@ -52,6 +53,9 @@ class Semaphore
 		void P();	// these are the only operations on a semaphore
 		void V();	// they are both *atomic*
 
+		//! True if P would not block (only a hint, see WaitEvent)
+		bool IsAvailable() { return value > 0; }
+
 	private:
 		char *name;		//!< useful for debugging
 		int value;		//!< semaphore value
@@ -98,12 +102,25 @@ class Lock
 		//! in Release, and in Condition variable operations below.
 		bool isHeldByCurrentThread();	 
 
+		//! Thread holding the lock (NULL if free)
+		Thread *getOwner() { return owner; }
+
+		//! Highest priority of the waiting threads (priority inheritance)
+		int WaitersPriority();
+
+		//! Make a signaled thread acquire the lock (wait morphing)
+		void Reacquire(Thread *thread);
+
 	private:
 		char* name;				//!< for debugging
 		Listint * sleepqueue;	//!< threads waiting to acquire the lock
 		bool free;				//!< to know if the lock is free
 		Thread * owner;			//!< Thread who has acquired the lock
 
+		void AddWaiter(Thread *thread);		//!< Queue a thread on the busy lock
+		Thread *RemoveWaiter();			//!< Dequeue the next owner
+		void GiveTo(Thread *thread);		//!< Make a thread the owner
+
 	public:
 		//! Object type, for validity checks during system calls (must be the first public field)
 		ObjectType type;
@@ -117,7 +134,8 @@ class Lock
 // variable does not have a value, but threads may be queued, waiting
 // on the variable.  These are only operations on a condition variable: 
 //
-// Wait() -- relinquish the CPU until signaled, 
+// Wait() -- relinquish the CPU until signaled (releasing a lock
+//			   while waiting, if one is given),
 //
 // Signal() -- wake up a thread, if there are any waiting on 
 //			   the condition
@@ -137,17 +155,114 @@ class Condition
 		//! For debugging
 		char* getName() { return (name); }
 
-		void Wait(); 	     // Wait until the condition is signalled
+		void Wait(Lock *lock = NULL); // Wait until the condition is signalled
+		//! True if the waiters of the condition use this lock, or if there are none
+		bool CanWaitWith(Lock *lock) { return waitqueue -> IsEmpty() || this -> lock == lock; }
 		void Signal();     // Wake up one of the thread waiting on the condition 
 		void Broadcast();  // Wake up all threads waiting on the condition
 
 	private:
 		char* name;				//!< For debugging
 		Listint * waitqueue;	//!< Threads asked to wait
+		Lock * lock;		//!< Lock released by the waiters (NULL if none)
+
+		void WakeUp(Thread *thread);	//!< Wake up a waiter
 
 	public:
 		//! Object type, for validity checks during system calls (must be the first public field)
 		ObjectType type;
 };
 
+/*! \brief Defines the "reader-writer lock" synchronization tool
+//
+// A reader-writer lock is held either by any number of readers, or by
+// a single writer:
+//
+// AcquireRead -- wait until no writer holds the lock (and, with writer
+//                preference, until no writer waits for it)
+//
+// AcquireWrite -- wait until no thread holds the lock
+//
+// Release -- release the lock held by the calling thread, handing it
+//            over to the next writer or to all the waiting readers
+//
+// Without writer preference, the waiting readers go first when a
+// writer releases the lock. With writer preference, a writer waiting
+// for the lock blocks the new readers, so that writers cannot starve.
+*/
+class RWLock
+{
+	public:
+		//! Create a free reader-writer lock
+		RWLock(char* debugName, bool writerPreference);
+
+		//! Deallocate the lock
+		~RWLock();
+
+		//! For debugging
+		char* getName() { return (name); }
+
+		void AcquireRead();	// Acquire the lock as a reader
+		void AcquireWrite();	// Acquire the lock as the writer
+		void Release();		// Release the lock held by the current thread
+
+		//! True if the current thread holds the lock, as the writer or as a reader
+		bool isHeldByCurrentThread() { return writer == g_current_thread || readers -> Search(g_current_thread); }
+
+	private:
+		char* name;			//!< For debugging
+		bool writer_preference;		//!< Waiting writers block new readers
+		int nb_readers;			//!< Number of readers holding the lock
+		Listint * readers;		//!< Readers holding the lock (once per AcquireRead)
+		Thread * writer;		//!< Writer holding the lock (NULL if none)
+		Listint * readqueue;		//!< Readers waiting for the lock
+		Listint * writequeue;		//!< Writers waiting for the lock
+
+	public:
+		//! Object type, for validity checks during system calls (must be the first public field)
+		ObjectType type;
+};
+
+/*! \brief Defines the "barrier" synchronization tool
+//
+// A barrier blocks the threads which call Wait() until a given number
+// of threads (the parties) have called it. The last one wakes up all
+// the others, and the barrier is ready for the next round.
+*/
+class Barrier
+{
+	public:
+		//! Create a barrier for nbParties threads (> 0)
+		Barrier(char* debugName, int nbParties);
+
+		//! Deallocate the barrier
+		~Barrier();
+
+		//! For debugging
+		char* getName() { return (name); }
+
+		//! Wait for the other parties. Return true in the last thread to arrive
+		bool Wait();
+
+	private:
+		char* name;			//!< For debugging
+		int nb_parties;			//!< Threads to wait for in each round
+		int nb_arrived;			//!< Threads arrived in the current round
+		Listint * waitqueue;		//!< Threads waiting for the round to complete
+
+	public:
+		//! Object type, for validity checks during system calls (must be the first public field)
+		ObjectType type;
+};
+
+/*! Wait-for-any support (see SC_SELECT). A thread waiting for one of
+// several objects checks them with interrupts disabled, then calls
+// WaitEvent if none is ready. The objects call NotifyEvent whenever
+// they may become ready (Semaphore::V, data written in a pipe, ...),
+// which wakes up all the waiting threads: they check their objects
+// again. Both must be called with interrupts disabled.
+*/
+void WaitEvent(Time deadline);	// Sleep until NotifyEvent, or until deadline (if not 0)
+void NotifyEvent();		// Wake up the threads sleeping in WaitEvent
+
 #endif // SYNCH_H
@@ -21,6 +21,7 @@
 #include "filesys/oftable.h"
 #include "filesys/filesys.h"
 #include "utility/objid.h"
+#include "machine/timer.h"
 
 /*!  This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
@@ -29,6 +30,7 @@
 
 // Hardware components
 Machine* g_machine;	                //!< Machine (includes CPU and peripherals)
+Timer *g_timer;                          //!< Hardware timer (time sharing, real-time and timed waits)
 
 // Thread management
 Thread *g_current_thread;		//!< The thread holding the CPU
@@ -83,18 +85,40 @@ CleanupOK()
 //	if the interrupted thread called Yield at the point it is 
 //	was interrupted.
 //
+//	The handler fires the kernel timers whose date has passed.
+//	Real-time threads are preempted when they exceed their budget
+//	or when a real-time thread with an earlier deadline is ready. In
+//	time sharing mode, other threads are preempted when they have
+//	used their whole quantum (which depends on their priority level).
+//
+//	In tickless mode (g_cfg->Tickless), the timer is a one-shot timer
+//	programmed by the scheduler for the next of these events only.
+//
 //	\param dummy is because every interrupt handler takes one argument,
 //		whether it needs it or not.
 */
 //----------------------------------------------------------------------
-/*
 static void
-TimerInterruptHandler(int dummy)
+TimerInterruptHandler(int64_t /*dummy*/)
 {
-    if (machine->getStatus() != IdleMode)
-	machine->interrupt->YieldOnReturn();
+    g_stats->incrTimerInterrupts();
+    g_scheduler->RunTimers();
+
+    if (g_machine->GetStatus() != IDLE_MODE) {
+      if (g_scheduler->CheckRealTime(g_current_thread))
+	g_machine->interrupt->YieldOnReturn();
+      else if (g_cfg->TimeSharing && !g_current_thread->IsRealTime()
+	       && g_current_thread->QuantumUsed() >= g_scheduler->Quantum(g_current_thread)) {
+	DEBUG('t', (char *)"End of the quantum of thread \"%s\"\n",
+	      g_current_thread->GetName());
+	g_scheduler->QuantumExpired(g_current_thread);
+	g_machine->interrupt->YieldOnReturn();
+      }
+    }
+
+    // In tickless mode, program the next interrupt
+    g_scheduler->UpdateTimer();
 }
-*/
 
 //----------------------------------------------------------------------
 // Initialize
@@ -115,6 +139,8 @@ Initialize(int argc, char **argv)
   char* debugArgs = (char*)"";
   char filename[MAXSTRLEN];
   bool debugUserProg = false;	//!< single step user program
+  char *diskName = NULL;	//!< disk file given on the command line
+  bool batchJob = false;	//!< started by the batch runner (see batch.cc)
 
   strcpy(filename,CONFIGFILENAME);
 
@@ -135,10 +161,28 @@ Initialize(int argc, char **argv)
     if (!strcmp(*argv, (char*)"-f")) {
       strcpy(filename,*(argv + 1));
     }
+    if (!strcmp(*argv, (char*)"-disk") && argc > 1)
+      diskName = *(argv + 1);
+    if (!strcmp(*argv, (char*)"-job"))
+      batchJob = true;
   }
 
   // Scan configuration file to set up Nachos parameters
   g_cfg = new Config(filename); 
+  if (diskName != NULL) {
+    if (strlen(diskName) + strlen(".swap") >= MAXSTRLEN) {
+      printf("Disk file name too long: %s\n", diskName);
+      exit(-1);
+    }
+    strcpy(g_cfg->DiskFileName, diskName);
+    sprintf(g_cfg->SwapFileName, "%s.swap", diskName);
+  }
+  // The disk of a batch job is a copy of an initialized disk: do not
+  // format it nor copy the files again
+  if (batchJob) {
+    g_cfg->FormatDisk = false;
+    g_cfg->NbCopy = 0;
+  }
 
   // Set up debug level
   DebugInit(debugArgs);			// initialize DEBUG messages
@@ -188,6 +232,11 @@ Initialize(int argc, char **argv)
   // Remove g_current_thread from ready list (inserted by default)
   // because it is currently executing
   ASSERT(g_current_thread == g_scheduler->FindNextToRun());
+  g_current_thread->StartQuantum();
+
+  // Start the timer which preempts the threads and fires the
+  // kernel timers
+  g_timer = new Timer(TimerInterruptHandler, 0, false, g_cfg->Tickless);
   
   // Enable interrupts
   g_machine->interrupt->SetStatus(INTERRUPTS_ON);
@@ -221,6 +270,7 @@ Cleanup()
   printf("\nCleaning up...\n");    
   if (g_cfg->PrintStat) {
     g_stats->Print();
+    g_scheduler->PrintStats();
   }
   delete g_disk_driver;
   delete g_console_driver;
@@ -231,6 +281,7 @@ Cleanup()
   delete g_swap_manager;
   delete g_scheduler;
   delete g_stats;
+  delete g_timer;
   delete g_physical_mem_manager;
   delete g_page_fault_manager;
   delete g_cfg;
@@ -26,6 +26,10 @@ typedef enum {
   SEMAPHORE_TYPE = 0xdeefeaea,
   LOCK_TYPE = 0xdeefcccc,
   CONDITION_TYPE = 0xdeefcdcd,
+  RWLOCK_TYPE = 0xdeefabab,
+  BARRIER_TYPE = 0xdeefbaba,
+  PIPE_TYPE = 0xdeef1f0f,
+  MSGQUEUE_TYPE = 0xdeef3e55,
   FILE_TYPE = 0xdeadbeef,
   THREAD_TYPE = 0xbadcafe,
   INVALID_TYPE = 0xf0f0f0f
@@ -46,18 +50,23 @@ class DriverDisk;
 class DriverConsole;
 class DriverACIA;
 class Machine;
+class Timer;
 
 // Initialization and cleanup routines
 extern void Initialize(int argc, char **argv); 	//!< Initialization,
 						//!< called before anything else
 extern void Cleanup();				//!< Cleanup, called when
 						//!< Nachos is done.
+//! Run a batch of independent Nachos machines (see batch.cc)
+extern int RunBatch(char *batchfile, int nb_workers, char *nachos,
+		    char *configfile);
 // Global variables per type
 // By convention, all globals are in lower case and start by g_
 // ------------------------------------------------------------
 
 // Hardware components
 extern Machine* g_machine;	                //!< Machine (includes CPU and peripherals)
+extern Timer *g_timer;                          //!< Hardware timer (time sharing, real-time and timed waits)
 
 // Thread management
 extern Thread *g_current_thread;		//!< The thread holding the CPU
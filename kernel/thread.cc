@@ -19,12 +19,49 @@
 #include "kernel/msgerror.h"
 #include "kernel/synch.h"
 #include "kernel/scheduler.h"
+#include "userlib/syscall.h"
 
-#define UNSIGNED_LONG_AT_ADDR(addr) (*((unsigned long int*)(addr)))
+//! Maximum number of free simulator stacks kept for the next threads
+#define STACK_POOL_SIZE 64
 
-#define STACK_FENCEPOST 0xdeadbeef	// this is put at the end of the
-					// simulator stack, for detecting
-					// stack overflows
+//! Free simulator stacks (each SIMULATORSTACKSIZE bytes, between two
+//! guard pages), reused by the next threads
+static int8_t *stack_pool[STACK_POOL_SIZE];
+static int stack_pool_size = 0;
+
+//! Thread whose floating point registers are in the machine (see
+//! Thread::TakeFPU)
+static Thread *fp_owner = NULL;
+
+//----------------------------------------------------------------------
+// AllocSimulatorStack, FreeSimulatorStack
+/*!	Allocate a simulator stack, reusing a stack of a thread which
+//	finished if possible, and give it back. Stacks are mapped with a
+//	guard page on each side (see AllocBoundedArray), so that a stack
+//	overflow faults at once. Only STACK_POOL_SIZE free stacks are
+//	kept, the others are unmapped.
+*/
+//----------------------------------------------------------------------
+static int8_t *
+AllocSimulatorStack()
+{
+  if (stack_pool_size > 0) {
+    g_stats->incrSimStacks(true);
+    return stack_pool[--stack_pool_size];
+  }
+  g_stats->incrSimStacks(false);
+  return AllocBoundedArray(SIMULATORSTACKSIZE);
+}
+
+static void
+FreeSimulatorStack(int8_t *stack)
+{
+  g_stats->decrSimStacks();
+  if (stack_pool_size < STACK_POOL_SIZE)
+    stack_pool[stack_pool_size++] = stack;
+  else
+    DeallocBoundedArray(stack, SIMULATORSTACKSIZE);
+}
 
 //----------------------------------------------------------------------
 // Thread::Thread
@@ -38,9 +75,28 @@ Thread::Thread(char *threadName)
   name = new char[strlen(threadName)+1];
   strcpy(name,threadName);
   type = THREAD_TYPE;
+  id = -1;
 
   // No process owner yet
   process = NULL;
+  stackPointer = 0;
+
+  quantum_start = cpu_ticks = 0;
+  nb_quanta = nb_preemptions = 0;
+  on_cpu = false;
+
+  level = 0;
+  priority = base_priority = PRIO_DEFAULT;
+  waiting_lock = NULL;
+  held_locks = new Listint;
+  boosted = false;
+  boost_start = 0;
+  vruntime = 0;
+  blocked = false;
+
+  realtime = rt_throttled = false;
+  rt_period = rt_budget = rt_deadline = 0;
+  rt_release = rt_abs_deadline = rt_job_cpu = 0;
 }
 
 //----------------------------------------------------------------------
@@ -58,8 +114,14 @@ Thread::Thread(char *threadName)
 Thread::~Thread()
 {
     DEBUG('t', (char *)"Deleting thread \"%s\"\n", name);
+    DEBUG('t', (char *)"Thread \"%s\" ran %llu cycles in %d quanta, %d preempted\n",
+	  name, cpu_ticks, nb_quanta, nb_preemptions);
     type = INVALID_TYPE;
 
+    // A thread which did not finish (its start failed) still has its id
+    if (id != -1)
+      g_object_ids->RemoveObject(id);
+
     //CheckOverflow();
 
     // Delete the simulator stack In case this==g_current_thread, it
@@ -67,16 +129,25 @@ Thread::~Thread()
     // the system at system shutdown time. It this situation, we do not
     // free the stack since we are still using it
     if (this !=g_current_thread)
-      DeallocBoundedArray(simulator_context.stackBottom,simulator_context.stackSize);
-
-    // NB: the thread stack itself is not freed, we do not attempt to
-    // reuse the address space dedicated to stack The corresponding
-    // physical memory will be deallocated when the process will be
-    // deleted
+      FreeSimulatorStack(simulator_context.stackBottom);
 
     // Protect from other accesses to the process object
     IntStatus oldLevel = g_machine-> interrupt->SetStatus(INTERRUPTS_OFF);
 
+#ifdef ETUDIANTS_TP
+    // Free the pages of the user stack, its virtual area will be
+    // reused by the next thread of the process
+    if (process->numThreads > 1)
+      process->addrspace->StackRelease(stackPointer);
+#endif
+
+    // Give back the share of the processor of a real-time thread
+    g_scheduler->LeaveRealTime(this);
+
+    // The floating point registers of the machine are now garbage
+    if (fp_owner == this)
+      fp_owner = NULL;
+
     // Signals to the process that we terminated
     process->numThreads--;
 
@@ -87,6 +158,7 @@ Thread::~Thread()
 
     g_machine->interrupt->SetStatus(oldLevel);
 
+    delete held_locks;
     delete [] name;
 }
 
@@ -105,8 +177,12 @@ int Thread::Start(Process *owner, int32_t func, int arg)
     this -> process = owner;
     this -> process -> numThreads++;
 
+    // A new thread gets the priority of its creator
+    if (g_current_thread != NULL && g_current_thread != this)
+      this -> priority = this -> base_priority = g_current_thread -> base_priority;
+
     this -> stackPointer = this -> process -> addrspace -> StackAllocate();
-    int8_t *base_stack_addr = AllocBoundedArray(SIMULATORSTACKSIZE);
+    int8_t *base_stack_addr = AllocSimulatorStack();
 
     this -> InitSimulatorContext(base_stack_addr, SIMULATORSTACKSIZE);
     this -> InitThreadContext(func, this -> stackPointer, arg);
@@ -151,6 +227,10 @@ Thread::InitThreadContext(int32_t initialPCREG,int32_t initialSP, int32_t arg)
 
     // Set the stack register
     thread_context.int_registers[STACK_REG] = initialSP;
+
+    for (i = 0; i < NUM_FP_REGS; i++)
+	thread_context.float_registers[i] = 0;
+    thread_context.cc = 0;
 }
 
 //----------------------------------------------------------------------
@@ -168,6 +248,9 @@ void ThreadPrint(long arg)
 
 void StartThreadExecution(void) {
   printf("Starting thread\n");
+  // A new thread does not return from Scheduler::SwitchTo, delete the
+  // carcass of the thread which finished just before
+  g_scheduler->DeleteFinishedThread();
   g_machine->interrupt->SetStatus(INTERRUPTS_ON);
   g_machine->Run();
   // Should not return there ...
@@ -194,6 +277,10 @@ Thread::InitSimulatorContext(int8_t* base_stack_addr,
 
   ASSERT(base_stack_addr != NULL);
 
+#ifdef FAST_CONTEXT_SWITCH
+  simulator_context.sp = ContextInit(base_stack_addr, stack_size,
+				     StartThreadExecution);
+#else
   // Fill in buf with the current context
   // and then fill busf such that StartThreadExecution
   // will be called when a setcontext will be made on buf
@@ -206,40 +293,89 @@ Thread::InitSimulatorContext(int8_t* base_stack_addr,
   simulator_context.buf.uc_stack.ss_flags = 0;
   simulator_context.buf.uc_link = NULL;
   makecontext(&simulator_context.buf,StartThreadExecution,0);
+#endif
 
   // Setup kernel stack parameters for low-level context switch
   simulator_context.stackBottom = base_stack_addr;
   simulator_context.stackSize   = stack_size;
-
-  // Mark the bottom of the stack in order to detect stack overflows
-  UNSIGNED_LONG_AT_ADDR(simulator_context.stackBottom) = STACK_FENCEPOST;
 }
 
 //----------------------------------------------------------------------
 // Thread::Join
 /*!
-//      Sleep the thread until another thread finishes.
-//	\param Idthread thread to wait for
+//      Sleep the thread until another thread finishes. The thread is
+//      designated by its identifier, which is never reused, rather than
+//      by a pointer: another thread may be allocated at the same address
+//      once it is deleted.
+//	\param tid identifier of the thread to wait for
 //----------------------------------------------------------------------
 */
 void
-Thread::Join(Thread *Idthread)
+Thread::Join(int32_t tid)
 {
-    while (g_alive->Search(Idthread)) Yield();
+    while (g_object_ids->SearchObject(tid) != NULL) Yield();
+}
+
+//----------------------------------------------------------------------
+// Thread::StartQuantum, Thread::EndQuantum, Thread::QuantumUsed
+/*! 	Account for the time spent by the thread on the CPU. A quantum
+//	starts each time the thread gets the CPU, and when it is
+//	preempted at the end of its quantum but no other thread is ready.
+//	It ends when the thread goes to sleep (the idle time is not
+//	charged to the thread) or gives the CPU to another thread.
+*/
+//----------------------------------------------------------------------
+void
+Thread::StartQuantum()
+{
+  quantum_start = g_stats->getTotalTicks();
+  on_cpu = true;
+  nb_quanta++;
+}
+
+void
+Thread::EndQuantum()
+{
+  Time used = QuantumUsed();
+  cpu_ticks += used;
+  g_scheduler->AccountCpuTime(this, used);
+  on_cpu = false;
+}
+
+Time
+Thread::QuantumUsed()
+{
+  return on_cpu ? g_stats->getTotalTicks() - quantum_start : 0;
+}
+
+//----------------------------------------------------------------------
+// Thread::Preempted
+/*! 	Called by the timer interrupt handler when the thread has used
+//	its whole quantum. The thread yields the CPU when the handler
+//	returns, and starts a new quantum if no other thread is ready.
+*/
+//----------------------------------------------------------------------
+void
+Thread::Preempted()
+{
+  nb_preemptions++;
+  process->stat->incrPreemptions();
+  EndQuantum();
+  StartQuantum();
 }
 
 //----------------------------------------------------------------------
 // Thread::CheckOverflow
 /*! 	Check a thread's stack to see if it has overrun the space
-//	that has been allocated for it.  If we had a smarter compiler,
-//	we wouldn't need to worry about this, but we don't.
+//	that has been allocated for it.
 //
-// 	NOTE: Nachos will not catch all stack overflow conditions.
-//	In other words, your program may still crash because of an overflow.
+// 	Simulator stacks are mapped between two guard pages (see
+// 	AllocBoundedArray), so an overflow faults (SIGSEGV) as soon as
+// 	it happens and there is nothing left to check here.
 //
-// 	If you get bizarre results (such as seg faults where there is no code)
-// 	then you *may* need to increase the stack size.  You can avoid stack
-// 	overflows by not putting large data structures on the stack.
+// 	If you get seg faults where there is no code, you *may* need to
+// 	increase the stack size.  You can avoid stack overflows by not
+// 	putting large data structures on the stack.
 // 	Don't do this: void foo() { int bigArray[10000]; ... }
 */
 //----------------------------------------------------------------------
@@ -247,7 +383,6 @@ Thread::Join(Thread *Idthread)
 void
 Thread::CheckOverflow()
 {
-  ASSERT(UNSIGNED_LONG_AT_ADDR(simulator_context.stackBottom) == STACK_FENCEPOST);
 }
 
 //----------------------------------------------------------------------
@@ -271,6 +406,12 @@ Thread::Finish ()
   #ifdef ETUDIANTS_TP
     IntStatus old_status = g_machine -> interrupt -> GetStatus();
     g_machine -> interrupt -> SetStatus(INTERRUPTS_OFF);
+    g_alive -> RemoveItem(this);
+    // The identifier of a finished thread is no longer valid
+    if (id != -1) {
+      g_object_ids -> RemoveObject(id);
+      id = -1;
+    }
     g_thread_to_be_destroyed = this;
     this -> Sleep();
     g_machine -> interrupt -> SetStatus(old_status);
@@ -297,6 +438,9 @@ Thread::Finish ()
 //	Otherwise returns when the thread eventually works its way
 //	to the front of the ready list and gets re-scheduled.
 //
+//	A real-time thread which used its whole budget sleeps until the
+//	release of its next job.
+//
 //	NOTE: we disable interrupts, so that looking at the thread
 //	on the front of the ready list, and switching to it, can be done
 //	atomically.  On return, we re-set the interrupt level to its
@@ -313,6 +457,11 @@ Thread::Yield ()
 
     DEBUG('t', (char *)"Yielding thread \"%s\"\n", GetName());
 
+    if (rt_throttled && g_scheduler->NextJob(this)) {
+      (void) g_machine->interrupt->SetStatus(oldLevel);
+      return;
+    }
+
     nextThread = g_scheduler->FindNextToRun();
     if (nextThread != NULL) {
 	g_scheduler->ReadyToRun(this);
@@ -321,6 +470,46 @@ Thread::Yield ()
     (void) g_machine->interrupt->SetStatus(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Thread::YieldTo
+/*! 	Directed yield: give the CPU to a given thread, ahead of the
+//	other ready threads, for instance to hand a token to the thread
+//	waiting for it. The calling thread goes at the end of its ready
+//	list, as in Yield.
+//
+//	The CPU time is accounted as in any switch: the quantum of the
+//	calling thread ends, and the target starts a new quantum (see
+//	Scheduler::SwitchTo). The real-time threads keep their precedence,
+//	so that nothing happens if one of the two threads is a real-time
+//	thread, or if a real-time thread is ready.
+//
+//	\param target the thread to run
+//	\return true if the CPU was given to target (or target is the
+//	calling thread), false if target is not ready
+*/
+//----------------------------------------------------------------------
+bool
+Thread::YieldTo(Thread *target)
+{
+    IntStatus oldLevel = g_machine->interrupt->SetStatus(INTERRUPTS_OFF);
+    bool done = true;
+
+    ASSERT(this == g_current_thread);
+
+    if (target != this) {
+      done = !realtime && g_scheduler->RemoveReady(target);
+      if (done) {
+	DEBUG('t', (char *)"Thread \"%s\" yielding to thread \"%s\"\n",
+	      GetName(), target->GetName());
+	g_stats->incrDirectedYields();
+	g_scheduler->ReadyToRun(this);
+	g_scheduler->SwitchTo(target);
+      }
+    }
+    (void) g_machine->interrupt->SetStatus(oldLevel);
+    return done;
+}
+
 //----------------------------------------------------------------------
 // Thread::Sleep
 /*! 	Relinquish the CPU, because the current thread is blocked
@@ -351,6 +540,10 @@ Thread::Sleep ()
 
     DEBUG('t', (char *)"Sleeping thread \"%s\"\n", GetName());
 
+    // The thread does not use the CPU while it waits
+    EndQuantum();
+    blocked = true;
+
     // In case, there is nobody else to execute, we wait for an
     // interrupt In case there is no interrupt to come in the future,
     // Nachos exists
@@ -369,7 +562,9 @@ Thread::Sleep ()
 
 //----------------------------------------------------------------------
 // Thread::SaveProcessorState
-/*!	Save the CPU state of a user program on a context switch
+/*!	Save the CPU state of a user program on a context switch. The
+//	floating point registers stay in the machine until another
+//	thread uses them (see TakeFPU).
 */
 //----------------------------------------------------------------------
 void
@@ -379,10 +574,6 @@ Thread::SaveProcessorState()
     for(int i = 0; i < NUM_INT_REGS; i++) {
       this -> thread_context.int_registers[i] = g_machine -> ReadIntRegister(i);
     }
-    for(int i = 0; i < NUM_FP_REGS; i++) {
-      this -> thread_context.float_registers[i] = g_machine -> ReadFPRegister(i);
-    }
-    this -> thread_context.cc = g_machine -> ReadCC();
   #endif
   #ifndef ETUDIANTS_TP
     printf("**** Warning: method Thread::SaveProcessorState is not implemented yet\n");
@@ -393,6 +584,8 @@ Thread::SaveProcessorState()
 //----------------------------------------------------------------------
 // Thread::RestoreProcessorState
 /*!	Restore the CPU state of a user program on a context switch.
+//	The load-linked reservation of the previous thread is cleared,
+//	so that a store-conditional interrupted by the switch fails.
 */
 //----------------------------------------------------------------------
 
@@ -403,10 +596,9 @@ Thread::RestoreProcessorState()
     for(int i = 0; i < NUM_INT_REGS; i++) {
       g_machine -> WriteIntRegister(i, this -> thread_context.int_registers[i]);
     }
-    for(int i = 0; i < NUM_FP_REGS; i++) {
-      g_machine -> WriteFPRegister(i, this -> thread_context.float_registers[i]);
-    }
-    g_machine -> WriteCC(this -> thread_context.cc);
+    // Floating point instructions trap unless the thread owns the FPU
+    g_machine -> fpUsable = (fp_owner == this);
+    g_machine -> llBit = false;
     g_machine->mmu->translationTable = this->process->addrspace->translationTable;
   #endif
   #ifndef ETUDIANTS_TP
@@ -416,23 +608,79 @@ Thread::RestoreProcessorState()
 }
 
 //----------------------------------------------------------------------
-// Thread::SaveSimulatorState
-/*!	Save the simulator state.
+// Thread::TakeFPU
+/*!	Called on the first floating point instruction of the thread
+//	since it got the CPU, when the FPU holds the registers of another
+//	thread (FPUNUSABLE_EXCEPTION): save the registers of their owner,
+//	load those of the thread, and let the instruction restart.
 */
 //----------------------------------------------------------------------
 void
-Thread::SaveSimulatorState()
+Thread::TakeFPU()
 {
-  getcontext(&(simulator_context.buf));
+  ASSERT(this == g_current_thread && fp_owner != this);
+  if (fp_owner != NULL) {
+    for(int i = 0; i < NUM_FP_REGS; i++)
+      fp_owner -> thread_context.float_registers[i] = g_machine -> ReadFPRegister(i);
+    fp_owner -> thread_context.cc = g_machine -> ReadCC();
+  }
+  for(int i = 0; i < NUM_FP_REGS; i++)
+    g_machine -> WriteFPRegister(i, thread_context.float_registers[i]);
+  g_machine -> WriteCC(thread_context.cc);
+  fp_owner = this;
+  g_machine -> fpUsable = true;
+  g_stats -> incrFPUSwitches();
 }
 
 //----------------------------------------------------------------------
-// Thread::RestoreSimulatorState
-/*!	Restore simulator state.
+// Thread::SwitchSimulatorState
+/*!	Save the simulator state (the host stack and registers) of the
+//	thread, and resume nextThread where it was last switched out.
+//	Returns when another thread switches back to this one.
+//
+//	\param nextThread the thread to resume
 */
 //----------------------------------------------------------------------
 void
-Thread::RestoreSimulatorState()
+Thread::SwitchSimulatorState(Thread *nextThread)
+{
+#ifdef FAST_CONTEXT_SWITCH
+  ContextSwitch(&(simulator_context.sp), nextThread->simulator_context.sp);
+#else
+  swapcontext(&(simulator_context.buf), &(nextThread->simulator_context.buf));
+#endif
+}
+
+#ifdef FAST_CONTEXT_SWITCH
+//----------------------------------------------------------------------
+// ContextInit
+/*!	Build on a new stack the frame restored by ContextSwitch (see
+//	switch.s), so that switching to the stack calls func. The
+//	callee-saved registers start at zero, and func is entered with
+//	the stack aligned as required by the ABI.
+//
+//	\param stack lowest address of the stack
+//	\param stack_size size of the stack in bytes
+//	\param func function run by the new context, which must not return
+//	\return the initial stack pointer of the context
+*/
+//----------------------------------------------------------------------
+void *
+ContextInit(void *stack, unsigned long stack_size, void (*func)(void))
 {
-  setcontext(&(simulator_context.buf));
+  uintptr_t top = ((uintptr_t)stack + stack_size) & ~(uintptr_t)15;
+#if defined(__x86_64__)
+  // r15 r14 r13 r12 rbx rbp, then the return address of ContextSwitch
+  // at a 16-byte boundary, and a null return address for func
+  uintptr_t *frame = (uintptr_t *)(top - 16) - 6;
+  memset(frame, 0, 8 * sizeof(uintptr_t));
+  frame[6] = (uintptr_t)func;
+#elif defined(__aarch64__)
+  // x19-x28, x29, x30 (the return address), d8-d15
+  uintptr_t *frame = (uintptr_t *)(top - 160);
+  memset(frame, 0, 160);
+  frame[11] = (uintptr_t)func;
+#endif
+  return frame;
 }
+#endif
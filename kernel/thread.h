@@ -25,6 +25,7 @@ class Thread;
 #include "kernel/process.h"
 #include "utility/utility.h"
 #include "utility/stats.h"
+#include "kernel/switch.h"
 #include <ucontext.h> 
 
 // Size of the simulator's execution stack
@@ -34,11 +35,16 @@ class Thread;
 extern void ThreadPrint(long arg);	 
 
 class Semaphore;
+class Lock;
 class Process;
 
 /*! \brief Defines the context of the Nachos simulator */
 typedef struct {
+#ifdef FAST_CONTEXT_SWITCH
+  void *sp;              //!< Saved stack pointer (see ContextSwitch)
+#else
   ucontext_t buf;
+#endif
   int8_t *stackBottom;
   int stackSize;
 } simulatorContextT;
@@ -70,10 +76,13 @@ public:
   int Start(Process *owner, int32_t func, int arg);
 
   //! Wait for another thread to finish its execution
-  void Join(Thread *Idthread);
+  void Join(int32_t tid);
 
   //! Relinquish the CPU if any other thread is runnable.
   void Yield();  			
+
+  //! Give the CPU directly to a given ready thread (directed yield)
+  bool YieldTo(Thread *target);
     
   //! Put the thread to sleep and relinquish the processor 
   void Sleep();  			
@@ -99,19 +108,48 @@ public:
   //! Restore the processor registers.
   void RestoreProcessorState();
 
-  //! Save the state of the Nachos simulator.
-  void SaveSimulatorState();	
-    
-  //! Restore Nachos simulator state.
-  void RestoreSimulatorState();
+  //! Load the floating point registers of the thread (lazy FP switch)
+  void TakeFPU();
+
+  //! Save the state of the Nachos simulator and resume another thread.
+  void SwitchSimulatorState(Thread *nextThread);
 
   char* GetName() { return (name); }
+
+  //! Object identifier of the thread, for the system calls (-1 if none)
+  int32_t GetId() { return id; }
+  void SetId(int32_t tid) { id = tid; }
   Process* GetProcessOwner() { return process; }
 
+  //! Start a new quantum (the thread gets the CPU)
+  void StartQuantum();
+
+  //! Account for the CPU time used since the start of the quantum
+  void EndQuantum();
+
+  //! Time spent on the CPU since the start of the quantum
+  Time QuantumUsed();
+
+  //! Account for a preemption at the end of the quantum
+  void Preempted();
+
+  //! Total time spent on the CPU, including the current quantum
+  Time CpuTime() { return cpu_ticks + QuantumUsed(); }
+
+  //! True if the thread is a periodic real-time thread
+  bool IsRealTime() { return realtime; }
+
+  //! Fixed priority of the thread (see Scheduler::SetPriority),
+  //! including the priority it inherits from the waiters of its locks
+  int GetPriority() { return priority; }
+
 protected:
   //! Thread name (for debugging)   
   char* name;
 
+  //! Object identifier, removed from g_object_ids when the thread ends
+  int32_t id;
+
   //! Main resource container the thread is running in.
   Process *process;
 
@@ -121,6 +159,39 @@ protected:
   //! Thread context
   threadContextT thread_context;
 
+  //! Time sharing accounting
+  Time quantum_start;       //!< Date of the start of the current quantum
+  Time cpu_ticks;           //!< Time spent on the CPU
+  int nb_quanta;            //!< Number of times the thread got the CPU
+  int nb_preemptions;       //!< Number of quanta ended by the timer
+  bool on_cpu;              //!< True during a quantum
+
+  //! Scheduling state, managed by the scheduler
+  int level;                //!< Priority level in the multilevel feedback queue
+  int priority;             //!< Fixed priority (PRIO_HIGHEST to PRIO_LOWEST)
+
+  //! Priority inheritance (see Scheduler::UpdatePriority)
+  int base_priority;        //!< Priority set by SetPriority
+  Lock *waiting_lock;       //!< Lock the thread is blocked on
+  Listint *held_locks;      //!< Locks held by the thread
+  bool boosted;             //!< Running with an inherited priority
+  Time boost_start;         //!< Date the priority was inherited
+  Time vruntime;            //!< CPU time used, for the fair share scheduler
+  bool blocked;             //!< True while the thread is sleeping
+
+  //! Real-time parameters and state of the current job (see Scheduler::SetRealTime)
+  bool realtime;            //!< True for a periodic real-time thread
+  Time rt_period;           //!< Period, in cycles
+  Time rt_budget;           //!< CPU time allowed per job
+  Time rt_deadline;         //!< Relative deadline of a job
+  Time rt_release;          //!< Release date of the current job
+  Time rt_abs_deadline;     //!< Absolute deadline of the current job
+  Time rt_job_cpu;          //!< CPU time of the thread when the job started
+  bool rt_throttled;        //!< The job used its whole budget
+
+  friend class Scheduler;
+  friend class Lock;
+
 public:
   //! signature to make sure the thread is in the correct state
   ObjectType type;
@@ -23,7 +23,9 @@
 #include "machine/machine.h"
 #include "kernel/system.h"
 #include "kernel/thread.h"
+#include "kernel/scheduler.h"
 #include "utility/stats.h"
+#include "vm/physMem.h"
 
 //! String definition for debugging messages
 static char *intLevelNames[] = { (char*)"off", (char*)"on"};
@@ -199,6 +201,10 @@ Interrupt::Idle()
 {
     DEBUG('i', (char*)"Machine idling; checking for interrupts.\n");
     g_machine->SetStatus(IDLE_MODE);
+#ifdef ETUDIANTS_TP
+    // Use the idle time to zero free physical pages in advance
+    g_physical_mem_manager->ZeroFreePages();
+#endif
     if (CheckIfDue(true)) {		// check for any pending interrupts
     	while (CheckIfDue(false))	// check for any other pending 
 	    ;				// interrupts
@@ -266,6 +272,40 @@ Interrupt::Schedule(VoidFunctionPtr handler, int64_t arg, int fromNow, IntType t
     pending->SortedInsert(toOccur, when);
 }
 
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+/*! 	Remove from the list of pending interrupts those scheduled by a
+//	device with a given handler and argument (used by a one-shot
+//	timer which is reprogrammed).
+//
+//	NOTE: like Schedule, only called by the hardware device simulators.
+//
+//	\param handler the procedure to call when the interrupt occurs
+//	\param arg the argument to pass to the procedure
+*/
+//----------------------------------------------------------------------
+void
+Interrupt::Cancel(VoidFunctionPtr handler, int64_t arg)
+{
+    ListTime *kept = new ListTime;
+    Time when;
+    PendingInterrupt *toOccur;
+
+    while ((toOccur = (PendingInterrupt *)pending->SortedRemove(&when)) != NULL) {
+      if (toOccur->handler == handler && toOccur->arg == arg) {
+	DEBUG('i', (char *)"Cancelling interrupt handler %s at time = %llu\n",
+	      intTypeNames[toOccur->type], when);
+	delete toOccur;
+      }
+      else
+	kept->Append(toOccur);
+    }
+    // The kept interrupts are still sorted
+    while ((toOccur = (PendingInterrupt *)kept->Remove()) != NULL)
+      pending->SortedInsert(toOccur, toOccur->when);
+    delete kept;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::CheckIfDue
 /*! 	Check if an interrupt is scheduled to occur, and if so, fire it off.
@@ -308,8 +348,9 @@ Interrupt::CheckIfDue(bool advanceClock)
   }
 
   // Check if there is nothing more to do, and if so, quit
+  // (the timer is still needed while some thread sleeps until a date)
   if ((g_machine->GetStatus() == IDLE_MODE) && (toOccur->type == TIMER_INT) 
-				&& pending->IsEmpty()) {
+				&& pending->IsEmpty() && !g_scheduler->HasTimers()) {
 	 pending->SortedInsert(toOccur, when);
 	 printf("this is the end \n");
 	 return false;
@@ -107,6 +107,9 @@ public:
   void Schedule(VoidFunctionPtr handler,//!< Schedule an interrupt to occur
 		  int64_t arg, int when, IntType type);//!< at time ``when''.  This is called
     					//!< by the hardware device simulators.
+
+  void Cancel(VoidFunctionPtr handler, int64_t arg);//!< Remove the scheduled
+					//!< interrupts of a device
     
   void OneTick(int nbcy);     // !<Advance simulated time of nbcy cycles
 
@@ -19,8 +19,8 @@
 static char* exceptionNames[] = { (char*)"no exception", (char*)"syscall", 
 				(char*)"page fault", (char*)"page read only",
 				(char*)"bus error", (char*)"address error", (char*)"overflow",
-				(char*)"illegal instruction" };
-#define EXCEPTION_NUMBER 7 //!< Size of exceptionNames, used for sanity checks
+				(char*)"illegal instruction", (char*)"FPU unusable" };
+#define EXCEPTION_NUMBER 8 //!< Size of exceptionNames, used for sanity checks
 
 //----------------------------------------------------------------------
 // CheckEndian
@@ -92,6 +92,14 @@ Machine::Machine(bool debug)
       int_registers[i] = 0;
     for (i = 0; i < NUM_FP_REGS; i++)
       float_registers[i] = 0;
+    cc = 0;
+
+    // The floating point registers belong to no thread yet
+    fpUsable = false;
+
+    // No load-linked reservation
+    llBit = false;
+    llAddr = 0;
 
     // Allocate the main memory of the machine and fills it up with zeroes
     int memSize = g_cfg->NumPhysPages * g_cfg->PageSize;
@@ -108,8 +116,8 @@ Machine::Machine(bool debug)
     // Create the machine sub-components
     this->mmu = new MMU();  
     this->interrupt = new Interrupt();  
-    this->disk = new Disk(DISK_FILE_NAME, DiskRequestDone);
-    this->diskSwap = new Disk(DISK_SWAP_NAME, DiskSwapRequestDone);
+    this->disk = new Disk(g_cfg->DiskFileName, DiskRequestDone);
+    this->diskSwap = new Disk(g_cfg->SwapFileName, DiskSwapRequestDone);
     this->console = new Console(NULL,NULL,ConsoleGet,ConsolePut);
     if (g_cfg->ACIA) this->acia = new ACIA(this); else this->acia = NULL;
 
@@ -157,6 +165,7 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     // Call of the exception handler
     int_registers[BADVADDR_REG] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
+    llBit = false;			// a SC after the exception fails
     this->status=SYSTEM_MODE;
     ExceptionHandler(which,badVAddr);	// call the exception handler
     this->status=USER_MODE;              // interrupts are enabled at this point
@@ -43,6 +43,8 @@ enum ExceptionType { NO_EXCEPTION,           //!< Everything ok!
 					     space */
 		     OVERFLOW_EXCEPTION,     //!< Integer overflow in add or sub.
 		     ILLEGALINSTR_EXCEPTION, //!< Unimplemented or reserved instr.
+		     FPUNUSABLE_EXCEPTION,   /*!< Floating point instruction
+					      while fpUsable is false */
 		     
 		     NUM_EXCEPTION_TYPES
 };
@@ -174,6 +176,18 @@ class Machine {
   int8_t cc;                     /*!< Condition code. Note that
 				 since only MIPS I FP instrs are implemented */
 
+  bool fpUsable;                /*!< False if the floating point registers
+				  belong to another thread than the running
+				  one: FP instructions raise
+				  FPUNUSABLE_EXCEPTION (coprocessor unusable) */
+
+  bool llBit;                   /*!< Reservation of the last load-linked
+				  (LL), cleared by a context switch, an
+				  exception or a store to the reserved
+				  word: a store-conditional (SC) only
+				  succeeds while it is set */
+  uint32_t llAddr;              //!< Physical address reserved by LL
+
   int8_t *mainMemory;		/*!< Physical memory to store user program,
 				  code and data, while executing
 				*/
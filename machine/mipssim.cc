@@ -174,13 +174,20 @@ Machine::OneInstruction(Instruction *instr)
   // Constant execution time for user instructions (see stats.h)
   execution_time = USER_TICK;
 
-  // Update statistics
-  g_current_thread->GetProcessOwner()->stat->incrNumInstruction();
-    
   // Decode instruction
   instr->value = raw;
   instr->Decode();
 
+  // Floating point instructions trap while the FPU holds the registers
+  // of another thread (lazy FP context switch), and are restarted
+  if (!fpUsable && instr->opCode >= OP_LWC1 && instr->opCode <= OP_CTC1) {
+    RaiseException(FPUNUSABLE_EXCEPTION, int_registers[PC_REG]);
+    return 0;
+  }
+
+  // Update statistics
+  g_current_thread->GetProcessOwner()->stat->incrNumInstruction();
+
   // Print its textual representation if debug flag 'm' is set
   if (DebugIsEnabled('m')) {
 
@@ -389,6 +396,21 @@ Machine::OneInstruction(Instruction *instr)
 	nextLoadValue = value;
 	break;
     	
+      case OP_LL:
+	tmp = int_registers[(int)instr->rs] + instr->extra;
+	if (tmp & 0x3) {
+	    RaiseException(ADDRESSERROR_EXCEPTION, tmp);
+	    return 0;
+	}
+	if (!mmu->ReadMem(tmp, 4, &value,false))
+	  return 0;
+	// The page is in memory now: reserve the physical word
+	mmu->Translate(tmp, &llAddr, 4, false);
+	llBit = true;
+	nextLoadReg = instr->rt;
+	nextLoadValue = value;
+	break;
+    	
       case OP_LWL:	  
 	tmp = int_registers[(int)instr->rs] + instr->extra;
 
@@ -594,6 +616,24 @@ Machine::OneInstruction(Instruction *instr)
 	    return 0;
 	break;
 	
+      case OP_SC:
+	tmp = int_registers[(int)instr->rs] + instr->extra;
+	if (tmp & 0x3) {
+	    RaiseException(ADDRESSERROR_EXCEPTION, tmp);
+	    return 0;
+	}
+	// The store only happens if nothing broke the reservation since
+	// the LL (a fault on the store clears it, so the restarted SC fails)
+	if (llBit) {
+	  if (!mmu->WriteMem(tmp, 4, int_registers[(int)instr->rt]))
+	    return 0;
+	  int_registers[(int)instr->rt] = 1;
+	}
+	else
+	  int_registers[(int)instr->rt] = 0;
+	llBit = false;
+	break;
+	
       case OP_SWL:	  
 	tmp = int_registers[(int)instr->rs] + instr->extra;
 
@@ -141,6 +141,11 @@ MMU::WriteMem(uint32_t addr, int size, uint32_t value)
 	return false;
     }
 
+    // A store to the word reserved by a load-linked makes the next
+    // store-conditional fail
+    if (g_machine->llBit && (physicalAddress & ~0x3) == g_machine->llAddr)
+      g_machine->llBit = false;
+
     // Write into the machine main memory
     switch (size) {
       case 1:
@@ -414,15 +414,14 @@ Random()
 
 //----------------------------------------------------------------------
 // AllocBoundedArray
-/*! 	Return an array, with the two pages just before 
-//	and after the array unmapped, to catch illegal references off
-//	the end of the array.  Particularly useful for catching overflow
-//	beyond fixed-size thread execution stacks.
+/*! 	Return an array, with the pages just before and after the
+//	array unmapped, to catch illegal references off the end of the
+//	array.  Particularly useful for catching overflow beyond
+//	fixed-size thread execution stacks: an overflow faults at once
+//	instead of silently corrupting memory.
 //
-//	Note: Just return the useful part!
-//      Makes sure that protected pages are on page size boundaries
-//      Assumes that the requested size is a multiple of page size
-//      (to be fixed)
+//	Note: Just return the useful part!  The size is rounded up to a
+//	multiple of the host page size.
 //
 //	\param size amount of useful space needed (in bytes)
 */
@@ -430,46 +429,26 @@ Random()
 int8_t* 
 AllocBoundedArray(size_t size)
 {
-  int8_t *ptr = new int8_t[size];
-  return ptr;
-
-  /*
-  IP: I commented that code because if was not safe wrt memory allocation
-  (the strange address calculations turn out to be wrong, the freed area
-  in DallocBoundedArray was not exactly the same as the area allocated in
-  AllocBoundedArray) - Anybody willing to correct that is strongly encouraged to
-  do so.
-
-  printf("AllocBoundedArray %d bytes \n",size);
-
   size_t pgSize = getpagesize();
-  ASSERT(size%pgSize == 0);
-  // Allocates more space than need due to alignment constraints of mprotect
-  // + 1 extra integer to find the base address when deallocating the data
-  int8_t *ptr = new int8_t[1 + pgSize * 3 + size];
-
+  size = (size_t)ALIGN_SUP(size, pgSize);
 
-  // Find the newt page boundary after the extra integer
-  int8_t *ptr_aligned_sup = ALIGN_SUP(ptr+1,pgSize);
-  // Store the offset from the returned allocated size just before the protected page
-  size_t* ptr_size = (size_t*) (ptr_aligned_sup-sizeof(size_t));
-  *ptr_size = ptr_aligned_sup - ptr;
-
-  printf("Alloc size %lu ptr 0x%lx ptrsize %d\n",1 + pgSize * 3 + size, ptr,*ptr_size);
+  int8_t *ptr = (int8_t *)mmap(NULL, size + 2 * pgSize, PROT_READ | PROT_WRITE,
+			       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == (int8_t *)MAP_FAILED) {
+    perror("AllocBoundedArray");
+    exit(-1);
+  }
 
   // Protects the page before and after the zone
-  mprotect(ptr_aligned_sup, pgSize, PROT_NONE);
-  mprotect(ptr_aligned_sup + pgSize + size, pgSize, PROT_NONE);
-
-  printf("Returned 0x%lx ptralignedsup 0x%lx  pgsize 0x%lx\n",ptr_aligned_sup + pgSize,ptr_aligned_sup,pgSize);
-  return (ptr_aligned_sup + pgSize);
-  */
-
+  mprotect(ptr, pgSize, PROT_NONE);
+  mprotect(ptr + pgSize + size, pgSize, PROT_NONE);
+  return ptr + pgSize;
 }
 
 //----------------------------------------------------------------------
 // DeallocBoundedArray
-/*! 	Deallocate an array of integers, unprotecting its two boundary pages.
+/*! 	Deallocate an array allocated by AllocBoundedArray, with its
+//	two boundary pages.
 //
 //	\param ptr the array to be deallocated
 //	\param size amount of useful space in the array (in bytes)
@@ -478,20 +457,7 @@ AllocBoundedArray(size_t size)
 void 
 DeallocBoundedArray(int8_t *ptr, size_t size)
 {
-  delete [] ptr;
-  /*
-  printf("DeallocBoundedArray %d bytes \n",size);
- 
   size_t pgSize = getpagesize();
-  size_t* ptr_size = (size_t*) ((ptr-pgSize-sizeof(size_t)));
-
-   // Unprotect the two pages
-   mprotect(ptr - pgSize, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
-   mprotect(ptr + size, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
-   
-   // De-allocate the whole area
-
-   printf("Free size %d ptr 0x%lx ptrsize %d\n",size,ptr - pgSize - *ptr_size,*ptr_size);
-
-   delete [] (ptr - pgSize - *ptr_size);*/
+  size = (size_t)ALIGN_SUP(size, pgSize);
+  munmap(ptr - pgSize, size + 2 * pgSize);
 }
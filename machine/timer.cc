@@ -41,14 +41,21 @@ static void TimerHandler(int64_t arg)
 //      \param callArg is the parameter to be passed to the interrupt handler.
 //      \param doRandom if true, arrange for the interrupts to occur
 //		at random, instead of fixed, intervals.
+//      \param oneShot if true, the timer only interrupts at the dates
+//		programmed by SetDeadline.
 */
 //----------------------------------------------------------------------
 
-Timer::Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom)
+Timer::Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom,
+	     bool oneShot)
 {
     randomize = doRandom;
     handler = timerHandler;
     arg = callArg; 
+    this->oneShot = oneShot;
+    deadline = 0;
+    if (oneShot)
+      return;
 
     // schedule the first interrupt from the timer device
     g_machine->interrupt->Schedule(TimerHandler, (int64_t) this, TimeOfNextInterrupt(), 
@@ -65,6 +72,12 @@ Timer::Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom)
 void 
 Timer::TimerExpired() 
 {
+    if (oneShot) {
+      deadline = 0;
+      (*handler)(arg);
+      return;
+    }
+
     // schedule the next timer device interrupt
     g_machine->interrupt->Schedule(TimerHandler, (int64_t) this, TimeOfNextInterrupt(), 
 		TIMER_INT);
@@ -73,6 +86,33 @@ Timer::TimerExpired()
     (*handler)(arg);
 }
 
+//----------------------------------------------------------------------
+// Timer::SetDeadline
+/*!      One-shot mode: program the next interrupt of the timer,
+//	replacing the one programmed before.
+//
+//      \param when date of the interrupt in cycles (an interrupt at
+//		the current date occurs at the next cycle), 0 to stop
+//		the timer.
+*/
+//----------------------------------------------------------------------
+void
+Timer::SetDeadline(Time when)
+{
+    ASSERT(oneShot);
+    Time now = g_stats->getTotalTicks();
+    if (when != 0 && when <= now)
+      when = now + 1;
+    if (when == deadline)
+      return;
+    if (deadline != 0)
+      g_machine->interrupt->Cancel(TimerHandler, (int64_t) this);
+    deadline = when;
+    if (when != 0)
+      g_machine->interrupt->Schedule(TimerHandler, (int64_t) this, when - now,
+				     TIMER_INT);
+}
+
 //----------------------------------------------------------------------
 // Timer::TimeOfNextInterrupt
 /*!      Return when the hardware timer device will next cause an interrupt.
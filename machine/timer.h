@@ -11,6 +11,10 @@
   	In order to introduce some randomness into time-slicing, if "doRandom"
   	is set, then the interrupt comes after a random number of ticks.
 
+	In one-shot mode, the timer does not interrupt periodically: the
+	kernel programs the date of the next interrupt (SetDeadline), as
+	with the deadline timers used by tickless kernels.
+
   DO NOT CHANGE -- part of the machine emulation
   
  Copyright (c) 1992-1993 The Regents of the University of California.
@@ -28,9 +32,15 @@
  */
 class Timer {
   public:
-    Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom);
+    Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom,
+	  bool oneShot = false);
 				//!< Initialize the timer, to call the interrupt
-				//!< handler "timerHandler" every time slice.
+				//!< handler "timerHandler" every time slice
+				//!< (or when programmed, in one-shot mode).
+
+    void SetDeadline(Time when);
+				//!< One-shot mode: interrupt at date "when"
+				//!< (in cycles), 0 stops the timer
     ~Timer() {}
 
 // Internal routines to the timer emulation -- DO NOT call these
@@ -45,6 +55,9 @@ class Timer {
     bool randomize;		//!< set if we need to use a random timeout delay
     VoidFunctionPtr handler;	//!< timer interrupt handler 
     int arg;			//!< argument to pass to interrupt handler
+    bool oneShot;		//!< set if the kernel programs each interrupt
+    Time deadline;		//!< one-shot mode: date of the programmed
+				//!< interrupt, 0 if none
 
 };
 
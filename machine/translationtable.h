@@ -124,8 +124,8 @@ class PageTableEntry {
 
   /*! Depending on the 'swap' bit:
     - swap == true : location, in terms of <b>PAGES</b>, in the swap
-    - swap == false: location, in terms of <b>BYTES</b>, from the beginning
-      of the executable file, or -1 for anonymous mapping */
+    - swap == false: -1, the page is loaded from the backing store of the
+      region containing it (see kernel/region.h) */
   int addrDisk;
 
   /*! This bit is set by the system every time the
@@ -0,0 +1,84 @@
+/* handoff.c
+ *	Lock handoff benchmark: NB_PRODUCERS producers and NB_CONSUMERS
+ *	consumers share a bounded buffer protected by a lock and two
+ *	condition variables. Run it with LockHandoff = 0 and then 1 in
+ *	the configuration file, and compare the "Context switches" line
+ *	of the statistics printed at the end of the run, e.g.
+ *
+ *	    ./nachos -x /handoff
+ *
+//  Copyright (c) 1999-2000 INSA de Rennes.
+//  All rights reserved.  
+//  See copyright_insa.h for copyright notice and limitation 
+//  of liability and disclaimer of warranty provisions.
+ */
+
+#include "userlib/syscall.h"
+#include "userlib/libnachos.h"
+
+#define NB_PRODUCERS 4
+#define NB_CONSUMERS 4
+#define NB_ITEMS     2000	/* per producer */
+#define BUFFER_SIZE  4
+
+LockId lock;
+CondId not_full, not_empty;
+int buffer[BUFFER_SIZE];
+int count, in, out;
+int sum;
+
+void
+producer(int arg)
+{
+  int i;
+  for (i = 1; i <= NB_ITEMS; i++) {
+    LockAcquire(lock);
+    while (count == BUFFER_SIZE)
+      CondWait(not_full, lock);
+    buffer[in] = i;
+    in = (in + 1) % BUFFER_SIZE;
+    count++;
+    CondSignal(not_empty);
+    LockRelease(lock);
+  }
+  Exit(0);
+}
+
+void
+consumer(int arg)
+{
+  int i;
+  for (i = 0; i < NB_ITEMS * NB_PRODUCERS / NB_CONSUMERS; i++) {
+    LockAcquire(lock);
+    while (count == 0)
+      CondWait(not_empty, lock);
+    sum += buffer[out];
+    out = (out + 1) % BUFFER_SIZE;
+    count--;
+    CondSignal(not_full);
+    LockRelease(lock);
+  }
+  Exit(0);
+}
+
+int
+main()
+{
+  ThreadId threads[NB_PRODUCERS + NB_CONSUMERS];
+  int i;
+
+  lock = LockCreate("buffer");
+  not_full = CondCreate("not_full");
+  not_empty = CondCreate("not_empty");
+
+  for (i = 0; i < NB_CONSUMERS; i++)
+    threads[i] = newThread("consumer", (int)consumer, i);
+  for (i = 0; i < NB_PRODUCERS; i++)
+    threads[NB_CONSUMERS + i] = newThread("producer", (int)producer, i);
+  for (i = 0; i < NB_PRODUCERS + NB_CONSUMERS; i++)
+    Join(threads[i]);
+
+  n_printf("%d items, sum %d (expected %d)\n", NB_ITEMS * NB_PRODUCERS, sum,
+	   NB_PRODUCERS * NB_ITEMS * (NB_ITEMS + 1) / 2);
+  return 0;
+}
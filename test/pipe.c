@@ -0,0 +1,76 @@
+/* pipe.c
+ *	Pipe throughput test: a writer thread sends NB_BLOCKS blocks of
+ *	BLOCK_SIZE bytes to a reader thread through a pipe. The buffers
+ *	are page-aligned, and the writer gives its buffer away with
+ *	PipeGift (it fills it again for each block), so that with
+ *	PipeZeroCopy = 1 in the configuration file the pages are moved
+ *	instead of copied.
+ *	Compare the "Pipes and message queues" line of the statistics
+ *	with PipeZeroCopy = 0 and 1, e.g.
+ *
+ *	    ./nachos -x /pipe
+ *
+//  Copyright (c) 1999-2000 INSA de Rennes.
+//  All rights reserved.  
+//  See copyright_insa.h for copyright notice and limitation 
+//  of liability and disclaimer of warranty provisions.
+ */
+
+#include "userlib/syscall.h"
+#include "userlib/libnachos.h"
+
+#define BLOCK_SIZE 1024		/* a multiple of the page size */
+#define NB_BLOCKS  64
+
+PipeId pipe;
+char out[BLOCK_SIZE] __attribute__((aligned(BLOCK_SIZE)));
+char in[BLOCK_SIZE] __attribute__((aligned(BLOCK_SIZE)));
+int errors;
+
+void
+writer(int arg)
+{
+  int i, j;
+  for (i = 0; i < NB_BLOCKS; i++) {
+    for (j = 0; j < BLOCK_SIZE; j++)
+      out[j] = i + j;
+    PipeGift(pipe, out, BLOCK_SIZE);
+  }
+  PipeClose(pipe);
+  Exit(0);
+}
+
+void
+reader(int arg)
+{
+  int i = 0, j, n, got = 0;
+  while ((n = PipeRead(pipe, in + got, BLOCK_SIZE - got)) > 0) {
+    got += n;
+    if (got < BLOCK_SIZE)
+      continue;
+    for (j = 0; j < BLOCK_SIZE; j++)
+      if (in[j] != (char)(i + j))
+	errors++;
+    got = 0;
+    i++;
+  }
+  if (i != NB_BLOCKS)
+    errors++;
+  Exit(0);
+}
+
+int
+main()
+{
+  ThreadId w, r;
+
+  pipe = PipeCreate("pipe");
+  r = newThread("reader", (int)reader, 0);
+  w = newThread("writer", (int)writer, 0);
+  Join(w);
+  Join(r);
+  PipeDestroy(pipe);
+
+  n_printf("%d bytes through the pipe, %d errors\n", NB_BLOCKS * BLOCK_SIZE, errors);
+  return 0;
+}
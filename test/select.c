@@ -0,0 +1,88 @@
+/* select.c
+ *	Select test: the main thread serves a pipe, a message queue and
+ *	a semaphore (V-ed by an alarm) from a single loop, waiting for
+ *	any of them with Select, while a producer thread feeds the pipe
+ *	and the queue.
+ *
+ *	    ./nachos -x /select
+ *
+//  Copyright (c) 1999-2000 INSA de Rennes.
+//  All rights reserved.
+//  See copyright_insa.h for copyright notice and limitation
+//  of liability and disclaimer of warranty provisions.
+ */
+
+#include "userlib/syscall.h"
+#include "userlib/libnachos.h"
+
+#define NB_ITEMS 16
+#define TIMEOUT  100000		/* cycles */
+
+PipeId pipe;
+MsgQueueId queue;
+
+void
+producer(int arg)
+{
+  char c;
+  int i;
+  for (i = 0; i < NB_ITEMS; i++) {
+    c = i;
+    PipeWrite(pipe, &c, 1);
+    MsgSend(queue, (char *)&i, sizeof(i));
+  }
+  PipeClose(pipe);
+  Exit(0);
+}
+
+int
+main()
+{
+  ThreadId p;
+  SemId alarm;
+  int ids[3], ready[3], nb = 3;
+  int bytes = 0, msgs = 0, alarms = 0, timeouts = 0, closed = 0;
+  int n, msg;
+  char c;
+
+  pipe = PipeCreate("pipe");
+  queue = MsgQueueCreate("queue", 4, sizeof(int));
+  alarm = SemCreate("alarm", 0);
+  Alarm(alarm, TIMEOUT / 2);
+  ids[0] = queue;
+  ids[1] = alarm;
+  ids[2] = pipe;
+  p = newThread("producer", (int)producer, 0);
+
+  while (!closed || msgs < NB_ITEMS) {
+    n = Select(ids, ready, nb, TIMEOUT);
+    if (n < 0) {
+      PError("Select");
+      break;
+    }
+    if (n == 0)
+      timeouts++;
+    if (ready[0] && MsgReceive(queue, (char *)&msg, sizeof(msg)) == sizeof(msg))
+      msgs++;
+    if (ready[1]) {
+      P(alarm);
+      alarms++;
+    }
+    if (nb == 3 && ready[2]) {
+      if (PipeRead(pipe, &c, 1) == 1)
+	bytes++;
+      else {
+	closed = 1;
+	nb = 2;			/* stop watching the pipe */
+      }
+    }
+  }
+  Join(p);
+  PipeDestroy(pipe);
+  MsgQueueDestroy(queue);
+  SemDestroy(alarm);
+
+  n_printf("%d bytes, %d messages, %d alarms, %d timeouts\n",
+	   bytes, msgs, alarms, timeouts);
+  return 0;
+}
@@ -0,0 +1,54 @@
+/* switch.c
+ *	Context switch benchmark: NB_THREADS threads yield the CPU to
+ *	each other NB_YIELDS times each, and the rate of switches per
+ *	second of simulated time (SysTime) is printed. Almost all the
+ *	host time is spent in the kernel context switch: the host time
+ *	of the run gives the rate in host time, e.g.
+ *
+ *	    time ./nachos -x /switch
+ *
+//  Copyright (c) 1999-2000 INSA de Rennes.
+//  All rights reserved.  
+//  See copyright_insa.h for copyright notice and limitation 
+//  of liability and disclaimer of warranty provisions.
+ */
+
+#include "userlib/syscall.h"
+#include "userlib/libnachos.h"
+
+#define NB_THREADS 8
+#define NB_YIELDS  10000
+
+void
+yielder(int arg)
+{
+  int i;
+  for (i = 0; i < NB_YIELDS; i++)
+    Yield();
+  Exit(0);
+}
+
+int
+main()
+{
+  ThreadId threads[NB_THREADS];
+  Nachos_Time start, end;
+  int i, switches, ms;
+
+  SysTime(&start);
+  for (i = 0; i < NB_THREADS; i++)
+    threads[i] = newThread("yielder", (int)yielder, i);
+  for (i = 0; i < NB_THREADS; i++)
+    Join(threads[i]);
+  SysTime(&end);
+
+  switches = NB_THREADS * NB_YIELDS;
+  ms = (end.seconds - start.seconds) * 1000
+    + (end.nanos - start.nanos) / 1000000;
+  if (ms > 0)
+    n_printf("%d context switches in %d ms, %d switches per second\n",
+	     switches, ms, switches * 1000 / ms);
+  else
+    n_printf("%d context switches in less than 1 ms\n", switches);
+  return 0;
+}
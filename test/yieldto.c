@@ -0,0 +1,71 @@
+/* yieldto.c
+ *	Directed yield test: two threads pass a token back and forth
+ *	NB_ROUNDS times, while NB_SPINNERS other threads are runnable.
+ *	A thread waiting for the token gives the CPU to the holder with
+ *	YieldTo, instead of waiting behind the spinners with Yield.
+ *	Compare the run time and the "Context switches" line of the
+ *	statistics with and without DIRECTED, e.g.
+ *
+ *	    ./nachos -x /yieldto
+ *
+//  Copyright (c) 1999-2000 INSA de Rennes.
+//  All rights reserved.
+//  See copyright_insa.h for copyright notice and limitation
+//  of liability and disclaimer of warranty provisions.
+ */
+
+#include "userlib/syscall.h"
+#include "userlib/libnachos.h"
+
+#define NB_ROUNDS   100
+#define NB_SPINNERS 4
+#define DIRECTED    1
+
+ThreadId players[2];
+int turn;
+int done;
+
+void
+player(int me)
+{
+  int i;
+  for (i = 0; i < NB_ROUNDS; i++) {
+    while (turn != me) {
+      /* The other player may not be created yet (0 is the caller) */
+      if (DIRECTED && players[1 - me] != 0)
+	YieldTo(players[1 - me]);
+      else
+	Yield();
+    }
+    turn = 1 - me;
+  }
+  Exit(0);
+}
+
+void
+spinner(int arg)
+{
+  while (!done)
+    Yield();
+  Exit(0);
+}
+
+int
+main()
+{
+  ThreadId spinners[NB_SPINNERS];
+  int i;
+
+  for (i = 0; i < NB_SPINNERS; i++)
+    spinners[i] = newThread("spinner", (int)spinner, i);
+  players[0] = newThread("ping", (int)player, 0);
+  players[1] = newThread("pong", (int)player, 1);
+  Join(players[0]);
+  Join(players[1]);
+  done = 1;
+  for (i = 0; i < NB_SPINNERS; i++)
+    Join(spinners[i]);
+
+  n_printf("%d rounds\n", NB_ROUNDS);
+  return 0;
+}
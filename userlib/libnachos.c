@@ -590,3 +590,165 @@ int n_read_int(void) {
   Read(buff,200,CONSOLE_INPUT);
   return n_atoi(buff);
 }
+
+//----------------------------------------------------------------------
+// n_atomic_xchg()
+/*!	Atomically replace the value of a word (n_atomic_cas and
+//	n_atomic_add are in sys.s)
+//
+//	\param addr is the address of the word,
+//	\param v the new value.
+//	\return the previous value of the word.
+*/
+//----------------------------------------------------------------------
+int n_atomic_xchg(volatile int *addr, int v)
+{
+  int old;
+  do {
+    old = *addr;
+  } while (n_atomic_cas(addr, old, v) != old);
+  return old;
+}
+
+//----------------------------------------------------------------------
+// n_spin_init(), n_spin_trylock(), n_spin_lock(), n_spin_unlock()
+/*!	Spinlocks. The machine has a single processor, so the holder of
+//	a busy spinlock cannot release it while we spin: n_spin_lock
+//	yields the CPU after each failed attempt.
+//
+//	\param l is the spinlock.
+*/
+//----------------------------------------------------------------------
+void n_spin_init(n_spin_t *l)
+{
+  l->locked = 0;
+}
+
+int n_spin_trylock(n_spin_t *l)
+{
+  return n_atomic_cas(&l->locked, 0, 1) == 0;
+}
+
+void n_spin_lock(n_spin_t *l)
+{
+  while (l->locked != 0 || n_atomic_cas(&l->locked, 0, 1) != 0)
+    Yield();
+}
+
+void n_spin_unlock(n_spin_t *l)
+{
+  l->locked = 0;
+}
+
+//----------------------------------------------------------------------
+// n_mutex_init(), n_mutex_lock(), n_mutex_unlock()
+/*!	Locks on a futex. The state of a lock is 0 when it is free, 1
+//	when it is held, and 2 when it is held and threads may sleep on
+//	it: only then does n_mutex_unlock enter the kernel.
+//
+//	\param m is the lock.
+*/
+//----------------------------------------------------------------------
+void n_mutex_init(n_mutex_t *m)
+{
+  m->state = 0;
+}
+
+// Take a lock, marking it as contended
+static void n_mutex_lock_contended(n_mutex_t *m)
+{
+  while (n_atomic_xchg(&m->state, 2) != 0)
+    FutexWait((int *)&m->state, 2);
+}
+
+void n_mutex_lock(n_mutex_t *m)
+{
+  if (n_atomic_cas(&m->state, 0, 1) != 0)
+    n_mutex_lock_contended(m);
+}
+
+void n_mutex_unlock(n_mutex_t *m)
+{
+  if (n_atomic_xchg(&m->state, 0) == 2)
+    FutexWake((int *)&m->state, 1);
+}
+
+//----------------------------------------------------------------------
+// n_sem_init(), n_sem_wait(), n_sem_post()
+/*!	Semaphores on a futex. The count never goes below 0, and the
+//	threads which sleep waiting for it to become positive are counted
+//	so that n_sem_post only enters the kernel when one may sleep.
+//
+//	\param s is the semaphore,
+//	\param count its initial value.
+*/
+//----------------------------------------------------------------------
+void n_sem_init(n_sem_t *s, int count)
+{
+  s->count = count;
+  s->waiters = 0;
+}
+
+void n_sem_wait(n_sem_t *s)
+{
+  for (;;) {
+    int c = s->count;
+    if (c > 0) {
+      if (n_atomic_cas(&s->count, c, c - 1) == c)
+	return;
+    }
+    else {
+      n_atomic_add(&s->waiters, 1);
+      FutexWait((int *)&s->count, 0);
+      n_atomic_add(&s->waiters, -1);
+    }
+  }
+}
+
+void n_sem_post(n_sem_t *s)
+{
+  n_atomic_add(&s->count, 1);
+  if (s->waiters > 0)
+    FutexWake((int *)&s->count, 1);
+}
+
+//----------------------------------------------------------------------
+// n_cond_init(), n_cond_wait(), n_cond_signal(), n_cond_broadcast()
+/*!	Condition variables on a futex. The word is a sequence number
+//	incremented by each signal, so that a signal sent between the
+//	release of the lock and the sleep is not lost.
+//
+//	\param c is the condition variable,
+//	\param m the lock held by the caller of n_cond_wait.
+*/
+//----------------------------------------------------------------------
+void n_cond_init(n_cond_t *c)
+{
+  c->seq = 0;
+  c->waiters = 0;
+}
+
+void n_cond_wait(n_cond_t *c, n_mutex_t *m)
+{
+  int seq = c->seq;
+  n_atomic_add(&c->waiters, 1);
+  n_mutex_unlock(m);
+  FutexWait((int *)&c->seq, seq);
+  n_atomic_add(&c->waiters, -1);
+  // Other threads woken up by a broadcast may sleep on the lock
+  n_mutex_lock_contended(m);
+}
+
+void n_cond_signal(n_cond_t *c)
+{
+  n_atomic_add(&c->seq, 1);
+  if (c->waiters > 0)
+    FutexWake((int *)&c->seq, 1);
+}
+
+void n_cond_broadcast(n_cond_t *c)
+{
+  n_atomic_add(&c->seq, 1);
+  if (c->waiters > 0)
+    FutexWake((int *)&c->seq, c->waiters);
+}
@@ -75,3 +75,44 @@ void* n_memcpy(void *s1, const void *s2, size_t n);
 
 // Set the first n bytes in a memory area to a specified value.
 void* n_memset(void *s, int c, size_t n);
+
+// Atomic operations and user-space synchronization :
+// --------------------------------------------------
+
+// If *addr is old, store new in it. Return the previous value of *addr.
+int n_atomic_cas(volatile int *addr, int old, int new_value);
+
+// Atomically add v to *addr. Return the previous value of *addr.
+int n_atomic_add(volatile int *addr, int v);
+
+// Atomically store v in *addr. Return the previous value of *addr.
+int n_atomic_xchg(volatile int *addr, int v);
+
+// Spinlocks (for short critical sections)
+typedef struct { volatile int locked; } n_spin_t;
+
+void n_spin_init(n_spin_t *l);
+int n_spin_trylock(n_spin_t *l);   // 1 if the lock was taken
+void n_spin_lock(n_spin_t *l);
+void n_spin_unlock(n_spin_t *l);
+
+// Locks, semaphores and condition variables on futexes (see FutexWait):
+// they only enter the kernel when a thread has to sleep or to be woken up.
+// Like the kernel ones, a condition variable may wake up a thread which
+// must check its condition again.
+typedef struct { volatile int state; } n_mutex_t;
+typedef struct { volatile int count; volatile int waiters; } n_sem_t;
+typedef struct { volatile int seq; volatile int waiters; } n_cond_t;
+
+void n_mutex_init(n_mutex_t *m);
+void n_mutex_lock(n_mutex_t *m);
+void n_mutex_unlock(n_mutex_t *m);
+
+void n_sem_init(n_sem_t *s, int count);
+void n_sem_wait(n_sem_t *s);
+void n_sem_post(n_sem_t *s);
+
+void n_cond_init(n_cond_t *c);
+void n_cond_wait(n_cond_t *c, n_mutex_t *m);
+void n_cond_signal(n_cond_t *c);
+void n_cond_broadcast(n_cond_t *c);
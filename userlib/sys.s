@@ -321,3 +321,282 @@ Mmap:	addiu $2,$0,SC_MMAP
 	syscall
 	j	$31
 	.end Mmap
+
+	.globl Madvise
+	.ent	Madvise
+Madvise:	addiu $2,$0,SC_MADVISE
+	syscall
+	j	$31
+	.end Madvise
+
+	.globl Mlock
+	.ent	Mlock
+Mlock:	addiu $2,$0,SC_MLOCK
+	syscall
+	j	$31
+	.end Mlock
+
+	.globl Munlock
+	.ent	Munlock
+Munlock:	addiu $2,$0,SC_MUNLOCK
+	syscall
+	j	$31
+	.end Munlock
+
+	.globl SetPriority
+	.ent	SetPriority
+SetPriority:	addiu $2,$0,SC_SET_PRIORITY
+	syscall
+	j	$31
+	.end SetPriority
+
+	.globl GetPriority
+	.ent	GetPriority
+GetPriority:	addiu $2,$0,SC_GET_PRIORITY
+	syscall
+	j	$31
+	.end GetPriority
+
+	.globl Nice
+	.ent	Nice
+Nice:	addiu $2,$0,SC_NICE
+	syscall
+	j	$31
+	.end Nice
+
+	.globl SetRealTime
+	.ent	SetRealTime
+SetRealTime:	addiu $2,$0,SC_SET_REALTIME
+	syscall
+	j	$31
+	.end SetRealTime
+
+	.globl WaitPeriod
+	.ent	WaitPeriod
+WaitPeriod:	addiu $2,$0,SC_WAIT_PERIOD
+	syscall
+	j	$31
+	.end WaitPeriod
+
+	.globl Sleep
+	.ent	Sleep
+Sleep:	addiu $2,$0,SC_SLEEP
+	syscall
+	j	$31
+	.end Sleep
+
+	.globl Alarm
+	.ent	Alarm
+Alarm:	addiu $2,$0,SC_ALARM
+	syscall
+	j	$31
+	.end Alarm
+
+	.globl FutexWait
+	.ent	FutexWait
+FutexWait:	addiu $2,$0,SC_FUTEX_WAIT
+	syscall
+	j	$31
+	.end FutexWait
+
+	.globl FutexWake
+	.ent	FutexWake
+FutexWake:	addiu $2,$0,SC_FUTEX_WAKE
+	syscall
+	j	$31
+	.end FutexWake
+
+	.globl RWLockCreate
+	.ent	RWLockCreate
+RWLockCreate:	addiu $2,$0,SC_RWLOCK_CREATE
+	syscall
+	j	$31
+	.end RWLockCreate
+
+	.globl RWLockDestroy
+	.ent	RWLockDestroy
+RWLockDestroy:	addiu $2,$0,SC_RWLOCK_DESTROY
+	syscall
+	j	$31
+	.end RWLockDestroy
+
+	.globl RWLockRead
+	.ent	RWLockRead
+RWLockRead:	addiu $2,$0,SC_RWLOCK_READ
+	syscall
+	j	$31
+	.end RWLockRead
+
+	.globl RWLockWrite
+	.ent	RWLockWrite
+RWLockWrite:	addiu $2,$0,SC_RWLOCK_WRITE
+	syscall
+	j	$31
+	.end RWLockWrite
+
+	.globl RWLockRelease
+	.ent	RWLockRelease
+RWLockRelease:	addiu $2,$0,SC_RWLOCK_RELEASE
+	syscall
+	j	$31
+	.end RWLockRelease
+
+	.globl BarrierCreate
+	.ent	BarrierCreate
+BarrierCreate:	addiu $2,$0,SC_BARRIER_CREATE
+	syscall
+	j	$31
+	.end BarrierCreate
+
+	.globl BarrierDestroy
+	.ent	BarrierDestroy
+BarrierDestroy:	addiu $2,$0,SC_BARRIER_DESTROY
+	syscall
+	j	$31
+	.end BarrierDestroy
+
+	.globl BarrierWait
+	.ent	BarrierWait
+BarrierWait:	addiu $2,$0,SC_BARRIER_WAIT
+	syscall
+	j	$31
+	.end BarrierWait
+
+	.globl PipeCreate
+	.ent	PipeCreate
+PipeCreate:	addiu $2,$0,SC_PIPE_CREATE
+	syscall
+	j	$31
+	.end PipeCreate
+
+	.globl PipeDestroy
+	.ent	PipeDestroy
+PipeDestroy:	addiu $2,$0,SC_PIPE_DESTROY
+	syscall
+	j	$31
+	.end PipeDestroy
+
+	.globl PipeWrite
+	.ent	PipeWrite
+PipeWrite:	addiu $2,$0,SC_PIPE_WRITE
+	syscall
+	j	$31
+	.end PipeWrite
+
+	.globl PipeRead
+	.ent	PipeRead
+PipeRead:	addiu $2,$0,SC_PIPE_READ
+	syscall
+	j	$31
+	.end PipeRead
+
+	.globl PipeClose
+	.ent	PipeClose
+PipeClose:	addiu $2,$0,SC_PIPE_CLOSE
+	syscall
+	j	$31
+	.end PipeClose
+
+	.globl MsgQueueCreate
+	.ent	MsgQueueCreate
+MsgQueueCreate:	addiu $2,$0,SC_MSGQ_CREATE
+	syscall
+	j	$31
+	.end MsgQueueCreate
+
+	.globl MsgQueueDestroy
+	.ent	MsgQueueDestroy
+MsgQueueDestroy:	addiu $2,$0,SC_MSGQ_DESTROY
+	syscall
+	j	$31
+	.end MsgQueueDestroy
+
+	.globl MsgSend
+	.ent	MsgSend
+MsgSend:	addiu $2,$0,SC_MSGQ_SEND
+	syscall
+	j	$31
+	.end MsgSend
+
+	.globl MsgReceive
+	.ent	MsgReceive
+MsgReceive:	addiu $2,$0,SC_MSGQ_RECEIVE
+	syscall
+	j	$31
+	.end MsgReceive
+
+	.globl Select
+	.ent	Select
+Select:	addiu $2,$0,SC_SELECT
+	syscall
+	j	$31
+	.end Select
+
+	.globl YieldTo
+	.ent	YieldTo
+YieldTo:	addiu $2,$0,SC_YIELD_TO
+	syscall
+	j	$31
+	.end YieldTo
+
+	.globl PipeGift
+	.ent	PipeGift
+PipeGift:	addiu $2,$0,SC_PIPE_GIFT
+	syscall
+	j	$31
+	.end PipeGift
+
+	.globl MsgGift
+	.ent	MsgGift
+MsgGift:	addiu $2,$0,SC_MSGQ_GIFT
+	syscall
+	j	$31
+	.end MsgGift
+
+/* -------------------------------------------------------------
+ * Atomic operations (see libnachos.h), with the load-linked and
+ * store-conditional instructions of the MIPS II: the store of SC
+ * only happens, and SC only sets its register to 1, if the thread
+ * was not switched out and nothing was stored in the word since the
+ * LL. Otherwise the operation starts again.
+ *
+ * n_atomic_cas(int *addr, int old, int new)
+ *	If *addr is old, store new in it. Return the previous value.
+ *
+ * n_atomic_add(int *addr, int v)
+ *	Add v to *addr. Return the previous value.
+ * -------------------------------------------------------------
+ */
+
+	.set	push
+	.set	mips2
+	.set	noreorder
+
+	.globl n_atomic_cas
+	.ent	n_atomic_cas
+n_atomic_cas:
+	ll	$2,0($4)
+	nop			/* load delay slot */
+	bne	$2,$5,1f
+	move	$8,$6
+	sc	$8,0($4)
+	beq	$8,$0,n_atomic_cas
+	nop
+1:	j	$31
+	nop
+	.end n_atomic_cas
+
+	.globl n_atomic_add
+	.ent	n_atomic_add
+n_atomic_add:
+	ll	$2,0($4)
+	nop			/* load delay slot */
+	addu	$8,$2,$5
+	sc	$8,0($4)
+	beq	$8,$0,n_atomic_add
+	nop
+	j	$31
+	nop
+	.end n_atomic_add
+
+	.set	pop
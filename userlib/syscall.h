@@ -62,6 +62,39 @@
 #define SC_FSLIST        33
 #define SC_SYS_TIME	 34 
 #define SC_MMAP		 35 
+#define SC_MADVISE	 36
+#define SC_MLOCK	 37
+#define SC_MUNLOCK	 38
+#define SC_SET_PRIORITY	 39
+#define SC_GET_PRIORITY	 40
+#define SC_NICE		 41
+#define SC_SET_REALTIME	 42
+#define SC_WAIT_PERIOD	 43
+#define SC_SLEEP	 44
+#define SC_ALARM	 45
+#define SC_FUTEX_WAIT	 46
+#define SC_FUTEX_WAKE	 47
+#define SC_RWLOCK_CREATE  48
+#define SC_RWLOCK_DESTROY 49
+#define SC_RWLOCK_READ	 50
+#define SC_RWLOCK_WRITE	 51
+#define SC_RWLOCK_RELEASE 52
+#define SC_BARRIER_CREATE 53
+#define SC_BARRIER_DESTROY 54
+#define SC_BARRIER_WAIT	 55
+#define SC_PIPE_CREATE	 56
+#define SC_PIPE_DESTROY	 57
+#define SC_PIPE_WRITE	 58
+#define SC_PIPE_READ	 59
+#define SC_PIPE_CLOSE	 60
+#define SC_MSGQ_CREATE	 61
+#define SC_MSGQ_DESTROY	 62
+#define SC_MSGQ_SEND	 63
+#define SC_MSGQ_RECEIVE	 64
+#define SC_SELECT	 65
+#define SC_YIELD_TO	 66
+#define SC_PIPE_GIFT	 67
+#define SC_MSGQ_GIFT	 68
 
 #ifndef IN_ASM
 
@@ -111,6 +144,72 @@ int Join(ThreadId id);
  */
 void Yield();		
 
+/* Yield the CPU directly to the thread "id", ahead of the other
+ * runnable threads, e.g. to hand it a token it waits for. If that
+ * thread is not runnable (or real-time threads are involved), behave
+ * like Yield.
+ * Return 0 if the CPU was given to "id", 1 otherwise, or a negative
+ * number if "id" is not a thread.
+ */
+int YieldTo(ThreadId id);
+
+/* Priorities of threads, used when SchedulerPolicy is Priority (see
+ * nachos.cfg). A new thread gets the priority of its creator.
+ */
+#define PRIO_HIGHEST   0
+#define PRIO_DEFAULT  16
+#define PRIO_LOWEST   31
+
+/* Set the priority of thread "id" (0 for the calling thread).
+ * Return a negative number if an error occured.
+ */
+int SetPriority(ThreadId id, int priority);
+
+/* Return the priority of thread "id" (0 for the calling thread), or a
+ * negative number if an error occured.
+ */
+int GetPriority(ThreadId id);
+
+/* Nice values of processes, used when SchedulerPolicy is Fair (see
+ * nachos.cfg): the share of the CPU of a process decreases by about
+ * 10% for each nice level. A new process gets the nice value of its
+ * creator.
+ */
+#define NICE_MIN     -20
+#define NICE_DEFAULT   0
+#define NICE_MAX      19
+
+/* Add "increment" to the nice value of the calling process (the result
+ * is bounded by NICE_MIN and NICE_MAX), and return the new nice value.
+ */
+int Nice(int increment);
+
+/* Make the calling thread a periodic real-time thread: it runs before
+ * all other threads, by earliest deadline first. Every "period" cycles
+ * a new job of the thread is released, which must complete (see
+ * WaitPeriod) within "deadline" cycles (0 means the period) and may
+ * use "budget" cycles of CPU time: a job which exceeds its budget is
+ * stopped until the next period. The thread is admitted only if the
+ * real-time threads do not overload the processor (see
+ * RealTimeUtilization in nachos.cfg). A period of 0 makes the thread
+ * a normal thread again. Times are rounded to the timer period.
+ * Return a negative number if an error occured.
+ */
+int SetRealTime(int period, int budget, int deadline);
+
+/* End the current job of the calling real-time thread, and wait for
+ * the release of the next one.
+ * Return a negative number if an error occured.
+ */
+int WaitPeriod();
+
+/* Put the calling thread to sleep for "cycles" cycles of simulated
+ * time (rounded up to the next timer interrupt when the timer is
+ * periodic). The processor runs the other threads, or stays idle.
+ * Return a negative number if an error occured.
+ */
+int Sleep(int cycles);
+
 /*! Print the last error message with the personalized one "mess" */
 void PError(char *mess); 
 
@@ -133,6 +232,9 @@ typedef int OpenFileId;
  */
 #define CONSOLE_INPUT	0  
 #define CONSOLE_OUTPUT	1  
+
+/* Identifier of the serial line in Select */
+#define TTY_INPUT	2
  
 /* Create a Nachos file, with "name" */
 int Create(char *name,int size);
@@ -202,6 +304,33 @@ int V(SemId sema);
 /* Do the operation V() on the semaphore sema */
 int P(SemId sema);
 
+/* Do a V on the semaphore "sema" in "cycles" cycles of simulated time,
+ * for instance to wait for an event with a timeout. The alarm replaces
+ * the previous alarm of the semaphore, and 0 cancels it. Return the
+ * number of cycles which were left before the previous alarm (0 if
+ * there was none), or a negative number if an error occured.
+ */
+int Alarm(SemId sema, int cycles);
+
+/* Futexes: the locks, semaphores and condition variables of libnachos
+ * (n_mutex_t, n_sem_t, n_cond_t) are words of the user memory updated
+ * with atomic operations, and only enter the kernel to sleep or to
+ * wake up sleeping threads. */
+
+/* Put the calling thread to sleep on the word at "addr", if it still
+ * holds "expected" (the test and the sleep are atomic), until a
+ * FutexWake on the same address. Return 0 after a wake up, 1 if the
+ * word did not hold "expected", or a negative number if an error
+ * occured.
+ */
+int FutexWait(int *addr, int expected);
+
+/* Wake up at most "count" threads sleeping on the word at "addr".
+ * Return the number of threads woken up, or a negative number if an
+ * error occured.
+ */
+int FutexWake(int *addr, int count);
+
 /* System calls concerning locks management */
 typedef int LockId;
 
@@ -234,10 +363,13 @@ CondId CondCreate(char * debug_name);
 */
 int CondDestroy(CondId id);
 
-/* Do the operation Wait on a condition variable.
+/* Do the operation Wait on a condition variable. If lock is not 0,
+   it must be held by the caller: it is released while the caller
+   waits, and held again when CondWait returns. All the threads
+   waiting on a condition at the same time must use the same lock.
    Returns a negative number if an error ocurred.
 */
-int CondWait(CondId cond);
+int CondWait(CondId cond, LockId lock);
 
 /* Do the operation Signal on a condition variable. 
    Return a negative number if an error ocurred.
@@ -249,6 +381,136 @@ int CondSignal(CondId cond);
 */
 int CondBroadcast(CondId cond);
 
+/* System calls concerning reader-writer locks */
+typedef int RWLockId;
+
+/* Create a reader-writer lock. If writer_preference is not 0, a
+   writer waiting for the lock blocks the new readers; otherwise the
+   waiting readers go before the writers when the lock is released.
+   Return an identifier */
+RWLockId RWLockCreate(char * debug_name, int writer_preference);
+
+/* Destroy a reader-writer lock.
+   Return a negative number if an error ocurred. */
+int RWLockDestroy(RWLockId id);
+
+/* Acquire the lock as a reader (several readers may hold it).
+   Return a negative number if an error ocurred. */
+int RWLockRead(RWLockId id);
+
+/* Acquire the lock as the only writer.
+   Return a negative number if an error ocurred. */
+int RWLockWrite(RWLockId id);
+
+/* Release the lock, acquired either as a reader or as the writer.
+   Return a negative number if an error ocurred. */
+int RWLockRelease(RWLockId id);
+
+/* System calls concerning barriers */
+typedef int BarrierId;
+
+/* Create a barrier for nb_parties threads.
+   Return an identifier, or a negative number if an error ocurred. */
+BarrierId BarrierCreate(char * debug_name, int nb_parties);
+
+/* Destroy a barrier.
+   Return a negative number if an error ocurred. */
+int BarrierDestroy(BarrierId id);
+
+/* Wait until nb_parties threads have called BarrierWait on the
+   barrier, which is then ready for a new round.
+   Return 1 in the last thread to arrive, 0 in the others, or a
+   negative number if an error ocurred. */
+int BarrierWait(BarrierId id);
+
+/* System calls concerning pipes and message queues.
+   The data in transit is kept by the kernel in a bounded buffer of
+   pages (PipeSize pages for a pipe, see nachos.cfg). PipeWrite and
+   MsgSend copy the data and never change the buffer of the sender.
+   When PipeZeroCopy is set (see nachos.cfg), the whole pages at a
+   page-aligned address are moved between the address spaces instead
+   of being copied: from a sender which gives its buffer away with
+   PipeGift or MsgGift, and to a receiver. */
+typedef int PipeId;
+
+/* Create an empty pipe.
+   Return an identifier */
+PipeId PipeCreate(char * debug_name);
+
+/* Destroy a pipe, with the data which was not read.
+   Return a negative number if an error ocurred. */
+int PipeDestroy(PipeId id);
+
+/* Write "size" bytes of "buffer" in the pipe, waiting for room in
+   the pipe as long as necessary.
+   Return the number of bytes written (less than size if the pipe was
+   closed meanwhile), or a negative number if an error ocurred. */
+int PipeWrite(PipeId id, char *buffer, int size);
+
+/* Same as PipeWrite, but the whole pages of "buffer" at a page-aligned
+   address may be moved into the pipe instead of being copied: the
+   pages of the stack or of the bss of the caller given this way are
+   filled with zeroes afterwards. */
+int PipeGift(PipeId id, char *buffer, int size);
+
+/* Read at most "size" bytes of the pipe in "buffer", waiting for data
+   if the pipe is empty.
+   Return the number of bytes read, 0 if the pipe is closed and empty,
+   or a negative number if an error ocurred. */
+int PipeRead(PipeId id, char *buffer, int size);
+
+/* Close a pipe: the readers get the remaining data, and the writers
+   fail.
+   Return a negative number if an error ocurred. */
+int PipeClose(PipeId id);
+
+typedef int MsgQueueId;
+
+/* Create an empty message queue, which holds at most max_msgs
+   messages of at most max_size bytes. Each message takes at least one
+   page of the kernel buffer, which is limited to NumPhysPages/16
+   pages (see nachos.cfg).
+   Return an identifier, or a negative number if an error ocurred
+   (in particular if the queue does not fit in this limit). */
+MsgQueueId MsgQueueCreate(char * debug_name, int max_msgs, int max_size);
+
+/* Destroy a message queue, with the messages which were not received.
+   Return a negative number if an error ocurred. */
+int MsgQueueDestroy(MsgQueueId id);
+
+/* Send the "size" bytes of "message", waiting for room in the queue
+   if it is full.
+   Return a negative number if an error ocurred. */
+int MsgSend(MsgQueueId id, char *message, int size);
+
+/* Same as MsgSend, but the whole pages of "message" may be moved into
+   the queue instead of being copied, as for PipeGift. */
+int MsgGift(MsgQueueId id, char *message, int size);
+
+/* Receive the first message of the queue in "buffer", waiting for a
+   message if the queue is empty. The end of a message longer than
+   "size" bytes is lost.
+   Return the number of bytes received, or a negative number if an
+   error ocurred. */
+int MsgReceive(MsgQueueId id, char *buffer, int size);
+
+/* Maximum number of objects in a call to Select */
+#define SELECT_MAX	32
+
+/* Wait until at least one of the "nb" objects of "ids" is ready, or
+   until "timeout" cycles have elapsed (-1: no timeout, 0: do not
+   wait). An object may be a semaphore (ready if P would not block), a
+   pipe (PipeRead would not block), a message queue (MsgReceive would
+   not block), CONSOLE_INPUT (a character was typed) or TTY_INPUT (a
+   message was received on the serial line). A destroyed object is
+   ready. Select does not consume anything: the ready object must be
+   read, or the semaphore taken, afterwards, and another thread may
+   take it first.
+   ready[i] is set to 1 if ids[i] is ready, 0 otherwise.
+   Return the number of ready objects (0 on timeout), or a negative
+   number if an error ocurred. */
+int Select(int *ids, int *ready, int nb, int timeout);
+
 /******************************************************************/
 /* System calls concerning serial port and console */
 
@@ -264,8 +526,35 @@ int TtySend(char *mess);
 int TtyReceive(char *mess,int length);
 
 /* Map an opened file in memory. Size is the size to be mapped in bytes.
+   Modified pages are written back to the file, which must stay open
+   while it is mapped. Return the address of the mapping, or a negative
+   number if an error occured.
 */
 int Mmap(OpenFileId f, int size);
 
+/* Access pattern hints given to Madvise */
+#define MADV_NORMAL      0  /* no particular access pattern (default) */
+#define MADV_RANDOM      1  /* random accesses: no read-ahead */
+#define MADV_SEQUENTIAL  2  /* sequential accesses: read ahead, drop behind */
+#define MADV_WILLNEED    3  /* pages will be needed soon: load them now */
+#define MADV_DONTNEED    4  /* pages will not be needed: release them */
+
+/* Tell the kernel how the memory area [addr,addr+size[ is going to be
+   accessed (see the MADV_* hints above), so that it can adapt its paging
+   decisions. Return a negative number if an error occured.
+*/
+int Madvise(int addr, int size, int advice);
+
+/* Load the pages of the memory area [addr,addr+size[ in physical memory
+   and keep them there until Munlock is called.
+   Return a negative number if an error occured.
+*/
+int Mlock(int addr, int size);
+
+/* Allow the pages of the memory area [addr,addr+size[ to be evicted again.
+   Return a negative number if an error occured.
+*/
+int Munlock(int addr, int size);
+
 #endif // IN_ASM
 #endif // SYSCALL_H
@@ -41,6 +41,12 @@ Config::Config(char *configname) {
   NumPhysPages=20;
   MaxVirtPages=1024;
   UserStackSize=8*1024;
+  UserStackInitSize=512;
+  ZeroedPoolSize=8;
+  MinWorkingSet=8;
+  AdmissionMaxDelay=50000;
+  PipeSize=4;
+  PipeZeroCopy=false;
   ProcessorFrequency = 100;
   MaxFileNameSize=256;
   NbCopy=0;
@@ -48,6 +54,13 @@ Config::Config(char *configname) {
   NumPortLoc=32009;
   NumPortDist=32009;
   PrintStat=false;
+  TimeSharing=false;
+  Tickless=false;
+  LockHandoff=true;
+  Quantum=5000;
+  BoostPeriod=100000;
+  SchedPolicy=SCHED_MLFQ;
+  RealTimeUtilization=90;
   FormatDisk=false;
   ListDir=false;
   PrintFileSyst=false;
@@ -57,6 +70,8 @@ Config::Config(char *configname) {
   RemoveDir=false;
   ACIA=ACIA_NONE;
   strcpy(ProgramToRun,"");
+  strcpy(DiskFileName,DISK_FILE_NAME);
+  strcpy(SwapFileName,DISK_SWAP_NAME);
 
   int nblignes=0;
 
@@ -116,6 +131,38 @@ Config::Config(char *configname) {
 	    fail(nblignes,configname,ligne);
 	  continue;
 	}
+	if (strcmp(commande,"UserStackInitSize") == 0) {
+	  if(sscanf(ligne," %s = %i ",commande,&UserStackInitSize)!=2)
+	    fail(nblignes,configname,ligne);
+	  continue;
+	}
+	if (strcmp(commande,"ZeroedPoolSize") == 0) {
+	  if(sscanf(ligne," %s = %i ",commande,&ZeroedPoolSize)!=2)
+	    fail(nblignes,configname,ligne);
+	  continue;
+	}
+	if (strcmp(commande,"PipeSize") == 0) {
+	  if(sscanf(ligne," %s = %i ",commande,&PipeSize)!=2)
+	    fail(nblignes,configname,ligne);
+	  continue;
+	}
+	if (strcmp(commande,"PipeZeroCopy") == 0){
+	  int v;
+	  if(sscanf(ligne," %s = %i ",commande,&v)==2)
+	    PipeZeroCopy = (v != 0);
+	  else fail(nblignes,configname,ligne);
+	  continue;
+	}
+	if (strcmp(commande,"MinWorkingSet") == 0) {
+	  if(sscanf(ligne," %s = %i ",commande,&MinWorkingSet)!=2)
+	    fail(nblignes,configname,ligne);
+	  continue;
+	}
+	if (strcmp(commande,"AdmissionMaxDelay") == 0) {
+	  if(sscanf(ligne," %s = %i ",commande,&AdmissionMaxDelay)!=2)
+	    fail(nblignes,configname,ligne);
+	  continue;
+	}
 	if (strcmp(commande,"MaxFileNameSize") == 0) {
 	  if(sscanf(ligne," %s = %i ",commande,&MaxFileNameSize)!=2)
 	    fail(nblignes,configname,ligne);
@@ -128,12 +175,66 @@ Config::Config(char *configname) {
 	  continue;
 	}
 	
+	if (strcmp(commande,"DiskFile") == 0) {
+	  if(sscanf(ligne," %s = %s ",commande,DiskFileName)!=2)
+	    fail(nblignes,configname,ligne);
+	  continue;
+	}
+
+	if (strcmp(commande,"SwapFile") == 0) {
+	  if(sscanf(ligne," %s = %s ",commande,SwapFileName)!=2)
+	    fail(nblignes,configname,ligne);
+	  continue;
+	}
+
 	if (strcmp(commande,"ProgramToRun") == 0) {
 	  if(sscanf(ligne," %s = %s ",commande,ProgramToRun)!=2)
 	    fail(nblignes,configname,ligne);
 	  continue;
 	}
 	
+	if (strcmp(commande,"Tickless") == 0){
+	  int v;
+	  if(sscanf(ligne," %s = %i ",commande,&v)==2)
+	    Tickless = (v != 0);
+	  else fail(nblignes,configname,ligne);
+	  continue;
+	}
+
+	if (strcmp(commande,"LockHandoff") == 0){
+	  int v;
+	  if(sscanf(ligne," %s = %i ",commande,&v)==2)
+	    LockHandoff = (v != 0);
+	  else fail(nblignes,configname,ligne);
+	  continue;
+	}
+
+	if (strcmp(commande,"TimeSharing") == 0){
+	  int v;
+	  if(sscanf(ligne," %s = %i ",commande,&v)==2)
+	    TimeSharing = (v != 0);
+	  else fail(nblignes,configname,ligne);
+	  continue;
+	}
+
+	if (strcmp(commande,"Quantum") == 0) {
+	  if(sscanf(ligne," %s = %i ",commande,&Quantum)!=2)
+	    fail(nblignes,configname,ligne);
+	  continue;
+	}
+
+	if (strcmp(commande,"BoostPeriod") == 0) {
+	  if(sscanf(ligne," %s = %i ",commande,&BoostPeriod)!=2)
+	    fail(nblignes,configname,ligne);
+	  continue;
+	}
+
+	if (strcmp(commande,"RealTimeUtilization") == 0) {
+	  if(sscanf(ligne," %s = %i ",commande,&RealTimeUtilization)!=2)
+	    fail(nblignes,configname,ligne);
+	  continue;
+	}
+
 	if (strcmp(commande,"PrintStat") == 0){
 	  int v;
 	  if(sscanf(ligne," %s = %i ",commande,&v)==2)
@@ -244,6 +345,21 @@ Config::Config(char *configname) {
 	continue;
       }
       
+      if (strcmp(commande,"SchedulerPolicy") == 0){
+	char policy[LINE_LENGTH];
+	if (sscanf(ligne," %s = %s ",commande,policy)==2) {
+	  if (strcmp(policy,"MLFQ")==0)
+	    SchedPolicy = SCHED_MLFQ;
+	  else if (strcmp(policy,"Priority")==0)
+	    SchedPolicy = SCHED_PRIORITY;
+	  else if (strcmp(policy,"Fair")==0)
+	    SchedPolicy = SCHED_FAIR;
+	  else fail(nblignes,configname,ligne);
+	}
+	else fail(nblignes,configname,ligne);
+	continue;
+      }
+
       if (strcmp(commande,"NumPortLoc") == 0){
 	if(sscanf(ligne," %s = %i ",commande,&NumPortLoc)!=2)
 	  fail(nblignes,configname,ligne);
@@ -22,6 +22,10 @@
 #define ACIA_BUSY_WAITING 1
 #define ACIA_INTERRUPT 2
 
+#define SCHED_MLFQ 0
+#define SCHED_PRIORITY 1
+#define SCHED_FAIR 2
+
 /*! \brief Defines Nachos hardware and software configuration 
 *
 * Used to avoid recompiling Nachos when a change in the configuration
@@ -50,13 +54,27 @@ class Config {
   int NumPortLoc;	   //!< Local ACIA's port number
   int NumPortDist;	   //!< Distant ACIA's port number
   char TargetMachineName[MAXSTRLEN];     //!< The name of the target machine for the ACIA
+  char DiskFileName[MAXSTRLEN];          //!< UNIX file simulating the disk
+  char SwapFileName[MAXSTRLEN];          //!< UNIX file simulating the swap disk
 
   // Kernel (process and address space) configuration
   int MaxVirtPages;        //!< Maximum number of virtual pages in each address space (used to allocate the page table)
-  bool TimeSharing;        //!< Use the time sharing mode if true (1) - not implemented in the base code
+  bool TimeSharing;        //!< Use the time sharing mode if true (1): threads are preempted by the timer at the end of their quantum
+  bool Tickless;           //!< Program the timer only for the next quantum end, budget end or wake up, instead of interrupting periodically
+  bool LockHandoff;        //!< Lock::Release gives the lock to the first waiter, and Condition::Signal moves the waiter to the queue of the lock (wait morphing), instead of waking threads which compete for the lock again
+  int Quantum;             //!< Time quantum of threads of the highest priority level in time sharing mode (in cycles), doubled at each lower level
+  int BoostPeriod;         //!< Period (in cycles) at which all threads are moved back to the highest priority level (0 to disable)
+  int RealTimeUtilization; //!< Maximum processor utilization (in percent) of the real-time threads (admission test)
+  int SchedPolicy;         //!< Scheduling policy: SCHED_MLFQ (multilevel feedback queue), SCHED_PRIORITY (fixed priorities, see SetPriority) or SCHED_FAIR (fair share, see Nice)
   int MagicNumber;         //!< 0x456789ab
   int MagicSize;           //!< Size of an integer 
-  int UserStackSize;       //!< Stack size of user threads in bytes
+  int UserStackSize;       //!< Maximum stack size of user threads in bytes
+  int UserStackInitSize;   //!< Initial stack size of user threads in bytes (stacks grow on page faults up to UserStackSize)
+  int ZeroedPoolSize;      //!< Maximum number of free physical pages zeroed in advance during idle time (0 to disable)
+  int MinWorkingSet;       //!< Working set estimate (in pages) of a new thread, and minimum estimate of a process, for admission control
+  int AdmissionMaxDelay;   //!< Maximum time (in cycles) Exec and NewThread wait for memory to be available (0 to disable admission control)
+  int PipeSize;            //!< Size (in pages) of the buffer of a pipe
+  bool PipeZeroCopy;       //!< PipeGift, MsgGift and the receivers move whole pages between address spaces instead of copying them, when the transfer is page-aligned
 
   // Configuration of actions to be done when Nachos is started and exited
   int NbCopy;              //!< Number of files to copy
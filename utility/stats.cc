@@ -11,6 +11,8 @@
 #include "kernel/copyright.h"
 #include "kernel/system.h"
 #include "utility/stats.h"
+#include "kernel/scheduler.h"
+#include "kernel/thread.h"
 
 //----------------------------------------------------------------------
 // Statistics::Statistics
@@ -22,6 +24,21 @@ Statistics::Statistics()
 {
   allStatistics = new Listint;
   idleTicks=totalTicks=0;
+  numIdleZeroedPages=numFaultZeroedPages=numPrezeroedPages=0;
+  idleZeroTicks=faultZeroTicks=0;
+  numAdmissionWaits=0;
+  admissionWaitTicks=maxAdmissionWait=0;
+  numRealTimeJobs=numDeadlineMisses=numBudgetOverruns=0;
+  numSimStacks=numSimStacksReused=simStacksInUse=maxSimStacksInUse=0;
+  numFPUSwitches=0;
+  numTimerInterrupts=0;
+  numPriorityInversions=0;
+  boostedTicks=0;
+  numContextSwitches=numLockHandoffs=numWaitMorphs=numDirectedYields=0;
+  numRWLockReadWaits=numRWLockWriteWaits=0;
+  numBarrierRounds=numBarrierWaits=0;
+  numPipeMovedPages=0;
+  pipeCopiedBytes=0;
 }
 
 
@@ -38,6 +55,8 @@ Statistics::Print()
   ProcessStat *s;
   int tmp;
   Listint *list =new Listint;
+  double share_sum = 0, share_sum2 = 0;
+  int nb_shares = 0;
 
   printf("\n");
 
@@ -46,6 +65,16 @@ Statistics::Print()
     s->Print();
     printf("\n");
     list->Append((void *)s);
+
+    // CPU share of the processes which ran user code, relative to
+    // their weight, for the fairness index
+    if (s->getUserTime() > 0) {
+      double share = (double)(s->getUserTime() + s->getSystemTime())
+	/ s->getWeight();
+      share_sum += share;
+      share_sum2 += share * share;
+      nb_shares++;
+    }
   }
   
   delete allStatistics;
@@ -55,6 +84,40 @@ Statistics::Print()
 	 idleTicks,g_cfg->ProcessorFrequency,
 	 cycle_to_sec(idleTicks,g_cfg->ProcessorFrequency),
 	 cycle_to_nano(idleTicks,g_cfg->ProcessorFrequency));
+  printf("   Page zeroing : %d pages in idle time (%llu cycles), %d pages on page faults (%llu cycles), %d faults served by a pre-zeroed page\n",
+	 numIdleZeroedPages,(unsigned long long)idleZeroTicks,
+	 numFaultZeroedPages,(unsigned long long)faultZeroTicks,numPrezeroedPages);
+  printf("   Admission control : %d requests delayed, %llu cycles waiting (longest wait %llu cycles)\n",
+	 numAdmissionWaits,(unsigned long long)admissionWaitTicks,
+	 (unsigned long long)maxAdmissionWait);
+  printf("   Timer : %d interrupts\n",numTimerInterrupts);
+  printf("   Context switches : %d (%d lock handoffs, %d morphed condition waits, %d directed yields)\n",
+	 numContextSwitches,numLockHandoffs,numWaitMorphs,numDirectedYields);
+  printf("   Simulator stacks : %d mapped, %d reused, at most %d in use (%d KB)\n",
+	 numSimStacks,numSimStacksReused,maxSimStacksInUse,
+	 maxSimStacksInUse*SIMULATORSTACKSIZE/1024);
+  if (numFPUSwitches > 0)
+    printf("   Floating point : %d lazy context switches\n",numFPUSwitches);
+  if (numPriorityInversions > 0)
+    printf("   Priority inheritance : %d inversions, %llu cycles with an inherited priority\n",
+	   numPriorityInversions,(unsigned long long)boostedTicks);
+  if (numRWLockReadWaits + numRWLockWriteWaits > 0)
+    printf("   Reader-writer locks : %d readers and %d writers blocked\n",
+	   numRWLockReadWaits,numRWLockWriteWaits);
+  if (numBarrierRounds + numBarrierWaits > 0)
+    printf("   Barriers : %d rounds, %d threads blocked\n",
+	   numBarrierRounds,numBarrierWaits);
+  if (numPipeMovedPages + pipeCopiedBytes > 0)
+    printf("   Pipes and message queues : %d pages moved, %lld bytes copied\n",
+	   numPipeMovedPages,pipeCopiedBytes);
+  if (numRealTimeJobs > 0)
+    printf("   Real-time : %d jobs, %d deadline misses, %d budget overruns\n",
+	   numRealTimeJobs,numDeadlineMisses,numBudgetOverruns);
+  // Jain's fairness index: 1 when all processes got a CPU time
+  // proportional to their weight, 1/n in the worst case
+  if (nb_shares > 0)
+    printf("   Fairness index : %.3f over %d processes\n",
+	   share_sum * share_sum / (nb_shares * share_sum2), nb_shares);
   printf("   Total time : %llu cycles on %dMz processor (%llu sec, %llu nanos) \n",
 	 totalTicks,g_cfg->ProcessorFrequency,
 	 cycle_to_sec(totalTicks,g_cfg->ProcessorFrequency),
@@ -101,6 +164,8 @@ ProcessStat::ProcessStat(char *processName)
   numInstruction=numDiskReads=numDiskWrites=0;
   numConsoleCharsRead=numConsoleCharsWritten=0;
   numMemoryAccess=numPageFaults=0;
+  numPreemptions=0;
+  weight=NICE_0_WEIGHT;
   systemTicks = userTicks = 0;
 }
 
@@ -170,6 +235,8 @@ void ProcessStat::Print(void)
 	 numConsoleCharsRead, numConsoleCharsWritten);
   printf("   Memory Management : %d accesses, %d page faults\n", 
 	   numMemoryAccess, numPageFaults);
+  printf("   Time sharing : %d preemptions at the end of a quantum\n",
+	 numPreemptions);
 
     printf("------------------------------------------------------------\n");
 }
@@ -28,6 +28,35 @@ class Statistics {
   Listint *allStatistics;      //!< enables to keep  statistics of all processes when they are finished.
   Time totalTicks;	   //!< Total time spent running Nachos
   Time idleTicks;           //!< Time spent idle (no thread to run)
+  int numIdleZeroedPages;   //!< Pages zeroed in advance during idle time
+  Time idleZeroTicks;       //!< Idle time spent zeroing pages
+  int numFaultZeroedPages;  //!< Pages zeroed on a page fault (pool empty)
+  Time faultZeroTicks;      //!< Time spent zeroing pages on page faults
+  int numPrezeroedPages;    //!< Page faults served by a pre-zeroed page
+  int numAdmissionWaits;    //!< Exec/NewThread requests delayed by admission control
+  Time admissionWaitTicks;  //!< Total time spent waiting for admission
+  Time maxAdmissionWait;    //!< Longest wait for admission
+  int numRealTimeJobs;      //!< Jobs (periods) of real-time threads
+  int numDeadlineMisses;    //!< Real-time jobs completed after their deadline
+  int numBudgetOverruns;    //!< Real-time jobs stopped at the end of their budget
+  int numSimStacks;         //!< Simulator stacks mapped
+  int numSimStacksReused;   //!< Simulator stacks taken from the pool
+  int simStacksInUse;       //!< Simulator stacks currently used by threads
+  int maxSimStacksInUse;    //!< High-water mark of simStacksInUse
+  int numFPUSwitches;       //!< Floating point contexts loaded on first use
+  int numTimerInterrupts;   //!< Timer interrupts handled by the kernel
+  int numPriorityInversions;//!< Threads blocked on a lock held by a lower priority thread
+  Time boostedTicks;        //!< Time spent by threads with an inherited priority
+  int numContextSwitches;   //!< Switches from a thread to another one
+  int numLockHandoffs;      //!< Locks given directly to a waiter on Release
+  int numWaitMorphs;        //!< Signaled threads moved to the queue of a busy lock
+  int numDirectedYields;    //!< Switches to a thread named by YieldTo
+  int numRWLockReadWaits;   //!< Readers blocked on a reader-writer lock
+  int numRWLockWriteWaits;  //!< Writers blocked on a reader-writer lock
+  int numBarrierRounds;     //!< Barrier rounds completed
+  int numBarrierWaits;      //!< Threads blocked on a barrier
+  int numPipeMovedPages;    //!< Pages moved in or out of pipes and message queues
+  long long pipeCopiedBytes;//!< Bytes copied in or out of pipes and message queues
                           
  public:
   Statistics();            // initialyses everything to zero
@@ -43,6 +72,30 @@ class Statistics {
   void setTotalTicks(Time val) {totalTicks=val;}
   Time getTotalTicks(void) {return totalTicks;}
   void incrIdleTicks (Time val) {idleTicks +=val;}
+  void incrIdleZeroedPages(Time val) {numIdleZeroedPages++; idleZeroTicks+=val;}
+  void incrFaultZeroedPages(Time val) {numFaultZeroedPages++; faultZeroTicks+=val;}
+  void incrPrezeroedPages(void) {numPrezeroedPages++;}
+  void incrRealTimeJobs(void) {numRealTimeJobs++;}
+  void incrDeadlineMisses(void) {numDeadlineMisses++;}
+  void incrBudgetOverruns(void) {numBudgetOverruns++;}
+  void incrSimStacks(bool reused) {if (reused) numSimStacksReused++; else numSimStacks++;
+    if (++simStacksInUse > maxSimStacksInUse) maxSimStacksInUse = simStacksInUse;}
+  void decrSimStacks(void) {simStacksInUse--;}
+  void incrFPUSwitches(void) {numFPUSwitches++;}
+  void incrTimerInterrupts(void) {numTimerInterrupts++;}
+  void incrPriorityInversions(void) {numPriorityInversions++;}
+  void incrBoostedTicks(Time val) {boostedTicks+=val;}
+  void incrContextSwitches(void) {numContextSwitches++;}
+  void incrLockHandoffs(void) {numLockHandoffs++;}
+  void incrWaitMorphs(void) {numWaitMorphs++;}
+  void incrDirectedYields(void) {numDirectedYields++;}
+  void incrRWLockWaits(bool writer) {if (writer) numRWLockWriteWaits++; else numRWLockReadWaits++;}
+  void incrBarrierRounds(void) {numBarrierRounds++;}
+  void incrBarrierWaits(void) {numBarrierWaits++;}
+  void incrPipeMovedPages(void) {numPipeMovedPages++;}
+  void incrPipeCopiedBytes(int val) {pipeCopiedBytes+=val;}
+  void incrAdmissionWait(Time val) {numAdmissionWaits++; admissionWaitTicks+=val;
+    if (val > maxAdmissionWait) maxAdmissionWait=val;}
 };
 
 
@@ -67,6 +120,8 @@ private:
   
   int numMemoryAccess;          //!< number of Memory accesses
   int numPageFaults;            //!< number of virtual memory page faults
+  int numPreemptions;           //!< number of threads preempted at the end of their quantum
+  int weight;                   //!< weight of the process in the fair share scheduler
 public:
   ProcessStat(char *name);      /* initialises everything to zero and 
                                      initialises the name of the process */
@@ -76,6 +131,9 @@ public:
   Time getSystemTime(void) {return systemTicks;}
   void incrMemoryAccess(void);
   void incrPageFault(void) {numPageFaults++;}
+  void incrPreemptions(void) {numPreemptions++;}
+  void setWeight(int w) {weight = w;}
+  int getWeight(void) {return weight;}
   void incrNumCharWritten(void) {numConsoleCharsWritten++;}
   void incrNumCharRead(void) {numConsoleCharsRead++;}
   void incrNumDiskReads(void) {numDiskReads++;}
@@ -90,6 +148,7 @@ public:
 #define USER_TICK       1   //!< average number of cycles for instruction
 #define SYSTEM_TICK     1   //!< average number of cycles for system call
 #define MEMORY_TICKS   10   //!< cycles the cpu takes to access a memory location
+#define ZERO_PAGE_TICKS (MEMORY_TICKS*g_cfg->PageSize/4) //!< cycles to fill a page with zeroes, one word at a time
 
 // Speed of the peripherals (expressed in nanoseconds)
 // The speeds of the peripherals are not linked to those of the CPU
@@ -12,6 +12,7 @@ Routines for the page fault managerPage Fault Manager
 #include "vm/swapManager.h"
 #include "vm/physMem.h"
 #include "vm/pagefaultmanager.h"
+#include "userlib/syscall.h"
 
 PageFaultManager::PageFaultManager() {
 }
@@ -22,16 +23,111 @@ PageFaultManager::PageFaultManager() {
 PageFaultManager::~PageFaultManager() {
 }
 
+#ifdef ETUDIANTS_TP
+//! Maximum number of pages loaded ahead of a fault in a sequential area
+#define READ_AHEAD_PAGES 4
+
+// static int MapPage(AddrSpace *as, TranslationTable *tt, uint32_t virtualPage)
+/*!
+//	Allocate a physical page for virtualPage in the address space of
+//	the current process, and fill it from the swap area, or from the
+//	backing store of the region containing the page. Pages filled with
+//	zeroes take a page of the pre-zeroed pool when there is one.
+//
+//	\param as the address space of the current process
+//	\param tt its translation table
+//	\param virtualPage the virtual page to load
+//	\return the physical page, still locked
+*/
+static int MapPage(AddrSpace *as, TranslationTable *tt, uint32_t virtualPage)
+{
+	Region *r = as->FindRegion(virtualPage);
+	ASSERT(r != NULL);
+
+	tt->setBitIo(virtualPage);
+
+	bool swapped = tt->getBitSwap(virtualPage);
+	bool zeroFill = !swapped && r->FileOffset(virtualPage) == -1;
+	bool zeroed = false;
+
+	int physPage = g_physical_mem_manager->AddPhysicalToVirtualMapping(as, virtualPage,
+									 zeroFill ? &zeroed : NULL);
+	tt->setPhysicalPage(virtualPage,physPage);
+	char *frame = (char *)&(g_machine->mainMemory[physPage*g_cfg->PageSize]);
+
+	if(swapped)
+	{
+		g_swap_manager->GetPageSwap(tt->getAddrDisk(virtualPage), frame);
+	}
+	else if(zeroFill)
+	{
+		// The page is zeroed by the faulting thread only when the
+		// pool of pre-zeroed pages is empty
+		if(!zeroed)
+		{
+			memset(frame, 0, g_cfg->PageSize);
+			g_current_thread->GetProcessOwner()->stat->incrSystemTicks(ZERO_PAGE_TICKS);
+			g_stats->incrFaultZeroedPages(ZERO_PAGE_TICKS);
+		}
+	}
+	else
+	{
+		r->ReadPage(virtualPage, frame);
+	}
+
+	// The page is now identical to its copy on disk
+	tt->clearBitM(virtualPage);
+	tt->clearBitU(virtualPage);
+	tt->clearBitIo(virtualPage);
+	tt->setBitValid(virtualPage);
+
+	return physPage;
+}
+
+// static void ReadAhead(AddrSpace *as, TranslationTable *tt, uint32_t virtualPage)
+/*!
+//	Load the pages following virtualPage in a region advised as
+//	sequential (see Madvise). Read-ahead stops at the end of the region
+//	and never evicts a page: only free physical pages are used.
+//
+//	\param as the address space of the current process
+//	\param tt its translation table
+//	\param virtualPage the virtual page which has just been loaded
+*/
+static void ReadAhead(AddrSpace *as, TranslationTable *tt, uint32_t virtualPage)
+{
+	// Read-ahead stays in the region of the faulting page
+	Region *r = as->FindRegion(virtualPage);
+
+	for (uint32_t vp = virtualPage+1; vp <= virtualPage+READ_AHEAD_PAGES; vp++)
+	{
+		if (!r->Contains(vp))
+			break;
+		if (tt->getBitValid(vp) || tt->getBitIo(vp))
+			continue;
+		if (!g_physical_mem_manager->HasFreePage())
+			break;
+		DEBUG('v', (char *)"Read-ahead of virtual page %d\n", vp);
+		g_physical_mem_manager->UnlockPage(MapPage(as, tt, vp));
+	}
+}
+#endif
+
 // ExceptionType PageFault(uint32_t virtualPage)
 /*! 	
 //	This method is called by the Memory Management Unit when there is a 
-//      page fault. This method loads the page from :
+//      page fault. This method loads the page from the backing
+//      store of the region containing it (see region.h), or from
+//      the swap area :
 //      - read-only sections (text,rodata) $\Rightarrow$ executive
 //        file
 //      - read/write sections (data,...) $\Rightarrow$ executive
 //        file (1st time only), or swap file
+//      - memory-mapped files $\Rightarrow$ mapped file
 //      - anonymous mappings (stack/bss) $\Rightarrow$ new
 //        page from the MemoryManager (1st time only), or swap file
+//      When the page belongs to an area advised as sequential, the
+//      next pages of the area are loaded too.
 //
 //	\param virtualPage the virtual page subject to the page fault
 //	  (supposed to be between 0 and the
@@ -43,6 +139,7 @@ ExceptionType PageFaultManager::PageFault(uint32_t virtualPage)
 {
 #ifdef ETUDIANTS_TP
 	TranslationTable *tt = g_machine->mmu->translationTable;
+	AddrSpace *as = g_current_thread->GetProcessOwner()->addrspace;
 	
 	while(tt->getBitIo(virtualPage))
 	{
@@ -51,39 +148,22 @@ ExceptionType PageFaultManager::PageFault(uint32_t virtualPage)
 	
 	if(!tt->getBitValid(virtualPage))
 	{
-	
-		tt->setBitIo(virtualPage);
-		int addrDisk = tt->getAddrDisk(virtualPage);
-		//char jean_charles_tableau[g_cfg->PageSize];
-	
-		int physPage = g_physical_mem_manager->AddPhysicalToVirtualMapping(g_current_thread->GetProcessOwner()->addrspace, virtualPage);
-		tt->setPhysicalPage(virtualPage,physPage);
-	
-		if(tt->getBitSwap(virtualPage) == 1)
-		{
-			while(addrDisk == -1)
-			{
-				g_current_thread->Yield();
-				addrDisk = tt->getAddrDisk(virtualPage);
-			}
-			
-			g_swap_manager->GetPageSwap(addrDisk, (char *)&(g_machine->mainMemory[tt->getPhysicalPage(virtualPage)*g_cfg->PageSize]));
-		}
-		else
+		// A page outside any region may be in the area reserved for
+		// the growth of a stack
+		if(as->FindRegion(virtualPage) == NULL
+		   && as->GrowStack(virtualPage) == NULL)
+			return ADDRESSERROR_EXCEPTION;
+
+		int physPage = MapPage(as, tt, virtualPage);
+
+		// The faulting page stays locked during read-ahead, so that
+		// it cannot be chosen as a victim
+		if(as->GetAdvice(virtualPage) == MADV_SEQUENTIAL)
 		{
-			if(addrDisk == -1)
-			{
-				memset(&(g_machine->mainMemory[tt->getPhysicalPage(virtualPage)*g_cfg->PageSize]), 0, g_cfg->PageSize);
-			}
-			else
-			{
-				g_current_thread->GetProcessOwner()->exec_file->ReadAt((char *)&(g_machine->mainMemory[tt->getPhysicalPage(virtualPage)*g_cfg->PageSize]), g_cfg->PageSize, addrDisk);
-			}
+			as->FindRegion(virtualPage)->last_fault = virtualPage;
+			ReadAhead(as, tt, virtualPage);
 		}
-		
-		tt->clearBitIo(virtualPage);
-		tt->setBitValid(virtualPage);
-		
+
 		g_physical_mem_manager->UnlockPage(physPage);
 	}	
 	
@@ -10,7 +10,9 @@
 //-----------------------------------------------------------------
 
 #include <unistd.h>
+#include <map>
 #include "vm/physMem.h"
+#include "userlib/syscall.h"
 
 //-----------------------------------------------------------------
 // PhysicalMemManager::PhysicalMemManager
@@ -32,12 +34,15 @@ PhysicalMemManager::PhysicalMemManager() {
     free_page_list.Append((void*)i);
   }
   i_clock=-1;
+  nb_zeroed_pages=0;
+  admission_next_ticket=admission_serving=0;
 }
 
 PhysicalMemManager::~PhysicalMemManager() {
   // Empty free page list
   int64_t page;
   while (!free_page_list.IsEmpty()) page =  (int64_t)free_page_list.Remove();
+  while (!zeroed_page_list.IsEmpty()) page =  (int64_t)zeroed_page_list.Remove();
 
   // Delete physical page table
   delete[] tpr;
@@ -61,7 +66,7 @@ void PhysicalMemManager::RemovePhysicalToVirtualMapping(long num_page) {
   // Update the physical page table entry
   tpr[num_page].free=true;
   tpr[num_page].locked=false;
-  if (tpr[num_page].owner->translationTable!=NULL) 
+  if (tpr[num_page].owner!=NULL && tpr[num_page].owner->translationTable!=NULL) 
     tpr[num_page].owner->translationTable->clearBitValid(tpr[num_page].virtualPage);
 
   // Insert the page in the free list
@@ -87,6 +92,83 @@ void PhysicalMemManager::UnlockPage(long num_page) {
   tpr[num_page].locked = false;
 }
 
+//-----------------------------------------------------------------
+// PhysicalMemManager::LockPage
+//
+/*! This method locks the page numPage, such that it is never
+//  chosen by the page replacement algorithm. Used by Mlock to pin
+//  pages in memory until they are unlocked by UnlockPage.
+//
+//  \param num_page is the number of the real page to lock
+*/
+//-----------------------------------------------------------------
+void PhysicalMemManager::LockPage(long num_page) {
+  ASSERT(num_page<g_cfg->NumPhysPages);
+  ASSERT(tpr[num_page].free==false);
+  tpr[num_page].locked = true;
+}
+
+//-----------------------------------------------------------------
+// PhysicalMemManager::DetachPage
+//
+/*! This method takes a physical page from the address space which
+//  owns it: the virtual page is no longer valid, and the physical page
+//  becomes a kernel page (no owner), locked in memory until it is
+//  given to an address space (AttachPage) or freed
+//  (RemovePhysicalToVirtualMapping). Used by pipes to move pages
+//  between address spaces without copying them.
+//
+//  \param num_page is the number of the real page to take
+*/
+//-----------------------------------------------------------------
+void PhysicalMemManager::DetachPage(long num_page) {
+  ASSERT(num_page<g_cfg->NumPhysPages);
+  ASSERT(!tpr[num_page].free && !tpr[num_page].locked);
+  tpr[num_page].owner->translationTable->clearBitValid(tpr[num_page].virtualPage);
+  tpr[num_page].owner = NULL;
+  tpr[num_page].locked = true;
+}
+
+//-----------------------------------------------------------------
+// PhysicalMemManager::AttachPage
+//
+/*! This method maps a kernel page (see DetachPage) at a virtual page
+//  of an address space. The virtual page must not be valid. The page
+//  is marked as modified, since it differs from the backing store of
+//  the virtual page, and is no longer locked.
+//
+//  \param num_page is the number of the real page
+//  \param owner address space receiving the page
+//  \param virtualPage virtual page where the page is mapped
+*/
+//-----------------------------------------------------------------
+void PhysicalMemManager::AttachPage(long num_page, AddrSpace* owner, int virtualPage) {
+  ASSERT(num_page<g_cfg->NumPhysPages);
+  ASSERT(!tpr[num_page].free && tpr[num_page].owner==NULL);
+  TranslationTable *tt = owner->translationTable;
+  ASSERT(!tt->getBitValid(virtualPage));
+  tpr[num_page].owner = owner;
+  tpr[num_page].virtualPage = virtualPage;
+  tpr[num_page].locked = false;
+  tt->setPhysicalPage(virtualPage,num_page);
+  tt->setBitM(virtualPage);
+  tt->setBitU(virtualPage);
+  tt->setBitValid(virtualPage);
+}
+
+//-----------------------------------------------------------------
+// PhysicalMemManager::NumLockedPages
+//
+/*! \return the number of physical pages currently locked in memory
+*/
+//-----------------------------------------------------------------
+int PhysicalMemManager::NumLockedPages(void) {
+  int nb = 0;
+  for (int i=0;i<g_cfg->NumPhysPages;i++)
+    if (!tpr[i].free && tpr[i].locked) nb++;
+  return nb;
+}
+
 //-----------------------------------------------------------------
 // PhysicalMemManager::ChangeOwner
 //
@@ -115,14 +197,30 @@ void PhysicalMemManager::ChangeOwner(long numPage, Thread* owner) {
 //
 //  \param owner address space (for backlink)
 //  \param virtualPage is the number of virtualPage to link with physical page
+//  \param zeroed if not NULL, the caller needs a page filled with zeroes:
+//         a pre-zeroed page is taken if there is one, and *zeroed tells
+//         whether the page still has to be zeroed
 //  \return A new physical page number.
 */
 //-----------------------------------------------------------------
-int PhysicalMemManager::AddPhysicalToVirtualMapping(AddrSpace* owner,int virtualPage) 
+int PhysicalMemManager::AddPhysicalToVirtualMapping(AddrSpace* owner,int virtualPage,bool *zeroed) 
 {
 #ifdef ETUDIANTS_TP
-	int page;
-	page = FindFreePage();
+	int page = -1;
+	if(zeroed != NULL)
+	{
+		*zeroed = !zeroed_page_list.IsEmpty();
+		if(*zeroed)
+		{
+			page = (int64_t)zeroed_page_list.Remove();
+			nb_zeroed_pages--;
+			ASSERT(tpr[page].free);
+			tpr[page].free = false;
+			g_stats->incrPrezeroedPages();
+		}
+	}
+	if(page == -1)
+		page = FindFreePage();
 	if(page == -1)
 		page = EvictPage();
 	tpr[page].owner = owner;
@@ -144,21 +242,29 @@ int PhysicalMemManager::AddPhysicalToVirtualMapping(AddrSpace* owner,int virtual
 /*! This method returns a new physical page number, if it finds one
 //  free. If not, return -1. Does not run the clock algorithm.
 //
+//  Pre-zeroed pages are taken last, so that they are kept for the
+//  pages which need to be zeroed.
+//
 //  \return A new free physical page number.
 */
 //-----------------------------------------------------------------
 int PhysicalMemManager::FindFreePage() {
   int64_t page;
 
-  // Check that the free list is not empty
-  if (free_page_list.IsEmpty())
+  // Check that the free lists are not empty
+  if (free_page_list.IsEmpty() && zeroed_page_list.IsEmpty())
     return -1;
 
   // Update statistics
   g_current_thread->GetProcessOwner()->stat->incrMemoryAccess();
   
   // Get a page from the free list
-  page = (int64_t)free_page_list.Remove();
+  if (!free_page_list.IsEmpty())
+    page = (int64_t)free_page_list.Remove();
+  else {
+    page = (int64_t)zeroed_page_list.Remove();
+    nb_zeroed_pages--;
+  }
   
   // Check that the page is really free
   ASSERT(tpr[page].free);
@@ -169,6 +275,101 @@ int PhysicalMemManager::FindFreePage() {
   return page;
 }
 
+//-----------------------------------------------------------------
+// PhysicalMemManager::ZeroFreePages
+//
+/*! This method fills free physical pages with zeroes and moves them
+//  to the pool of pre-zeroed pages, until the pool holds
+//  g_cfg->ZeroedPoolSize pages. It is called when the machine is idle,
+//  so that page faults on zero-filled pages (bss, stack) do not have
+//  to zero the page themselves.
+*/
+//-----------------------------------------------------------------
+void PhysicalMemManager::ZeroFreePages(void) {
+  while (nb_zeroed_pages < g_cfg->ZeroedPoolSize
+	 && !free_page_list.IsEmpty()) {
+    int64_t page = (int64_t)free_page_list.Remove();
+    ASSERT(tpr[page].free);
+    memset(&(g_machine->mainMemory[page*g_cfg->PageSize]),0,g_cfg->PageSize);
+    zeroed_page_list.Append((void*)page);
+    nb_zeroed_pages++;
+    g_stats->incrIdleZeroedPages(ZERO_PAGE_TICKS);
+  }
+}
+
+//-----------------------------------------------------------------
+// PhysicalMemManager::CanAdmit
+//
+/*! Admission control test. The working set of a process is estimated
+//  as its physical pages referenced since the last pass of the clock
+//  (bit U set) or locked, and at least g_cfg->MinWorkingSet pages.
+//  A new thread is admitted if there are enough free pages for it, or
+//  if the sum of the working sets leaves room for it.
+//
+//  \return true if a new thread can be admitted
+*/
+//-----------------------------------------------------------------
+bool PhysicalMemManager::CanAdmit(void) {
+  std::map<AddrSpace*,int> working_sets;
+  int nb_free = 0;
+
+  for (int i=0;i<g_cfg->NumPhysPages;i++) {
+    if (tpr[i].free)
+      nb_free++;
+    else if (tpr[i].locked
+	     || tpr[i].owner->translationTable->getBitU(tpr[i].virtualPage))
+      working_sets[tpr[i].owner]++;
+  }
+  if (nb_free >= g_cfg->MinWorkingSet)
+    return true;
+
+  int demand = g_cfg->MinWorkingSet;
+  std::map<AddrSpace*,int>::iterator it;
+  for (it = working_sets.begin(); it != working_sets.end(); it++)
+    demand += (it->second > g_cfg->MinWorkingSet) ? it->second : g_cfg->MinWorkingSet;
+  return demand <= g_cfg->NumPhysPages;
+}
+
+//-----------------------------------------------------------------
+// PhysicalMemManager::WaitForAdmission
+//
+/*! Called by Exec and NewThread before creating a thread. When memory
+//  is overcommitted, the calling thread waits (yielding the CPU) in a
+//  FIFO queue until the working sets leave room for a new thread, so
+//  that starting more threads does not make the system thrash.
+//  The thread at the head of the queue is admitted anyway after
+//  g_cfg->AdmissionMaxDelay cycles, so that waiting never blocks the
+//  system.
+*/
+//-----------------------------------------------------------------
+void PhysicalMemManager::WaitForAdmission(void) {
+  if (g_cfg->AdmissionMaxDelay <= 0)
+    return;
+  if (admission_serving == admission_next_ticket && CanAdmit())
+    return;
+
+  int ticket = admission_next_ticket++;
+  Time start = g_stats->getTotalTicks();
+  Time head_start = start;
+
+  DEBUG('v', (char *)"Thread %s waits for admission\n", g_current_thread->GetName());
+
+  // Wait to be at the head of the queue
+  while (ticket != admission_serving) {
+    g_current_thread->Yield();
+    head_start = g_stats->getTotalTicks();
+  }
+
+  // Wait for memory
+  while (!CanAdmit()
+	 && g_stats->getTotalTicks() - head_start < (Time)g_cfg->AdmissionMaxDelay)
+    g_current_thread->Yield();
+
+  admission_serving++;
+  g_stats->incrAdmissionWait(g_stats->getTotalTicks() - start);
+  DEBUG('v', (char *)"Thread %s admitted\n", g_current_thread->GetName());
+}
+
 //-----------------------------------------------------------------
 // PhysicalMemManager::EvictPage
 //
@@ -181,53 +382,78 @@ int PhysicalMemManager::FindFreePage() {
 int PhysicalMemManager::EvictPage()
 {
 #ifdef ETUDIANTS_TP
-	int local_i_clock = i_clock;
+  int victim = -1;
   int count = 0;
-  bool found = false;
-  tpr_c pPhys;
-  int pVirt;
-  TranslationTable *tt;
-  int secteur;
 
-  while(!found)
+  while (victim == -1)
   {
-    pPhys = tpr[local_i_clock];
-    pVirt = pPhys.virtualPage;
-    tt = pPhys.owner->translationTable;
+    i_clock = (i_clock + 1) % g_cfg->NumPhysPages;
+    struct tpr_c *p = &tpr[i_clock];
 
-    if(!tt->getBitU(pVirt) && pPhys.locked == false)
+    if (!p->free && !p->locked)
     {
-      found = true;
+      TranslationTable *tt = p->owner->translationTable;
+      // In a sequentially accessed area, only the pages behind the last
+      // page fault are dropped (they have most probably been read for
+      // the last time). The pages ahead of it were loaded by read-ahead
+      // and not used yet: they are spared during a first turn of the
+      // clock, so that read-ahead does not load them again and again.
+      Region *r = p->owner->FindRegion(p->virtualPage);
+      bool ahead = r != NULL && r->advice == MADV_SEQUENTIAL
+	&& p->virtualPage > r->last_fault;
+      if (!tt->getBitU(p->virtualPage) && !(ahead && count < g_cfg->NumPhysPages))
+	victim = i_clock;
+      else
+	tt->clearBitU(p->virtualPage);
     }
-    tt->clearBitU(pVirt);
 
-    // If all pages are locked, suspend current thread
-    if(count == g_cfg->NumPhysPages-1)
+    // If all pages are locked, let the other threads end their page
+    // faults and try again
+    if (victim == -1 && ++count == 2*g_cfg->NumPhysPages)
     {
-      i_clock = local_i_clock;
       g_current_thread->Yield();
-      local_i_clock = (i_clock)%(g_cfg->NumPhysPages-1);
+      int page = FindFreePage();
+      if (page != -1) return page;
       count = 0;
     }
-
-    if(!found)
-    {
-      local_i_clock = (local_i_clock+1)%(g_cfg->NumPhysPages-1);
-      count = count + 1;
-    }
   }
 
-  i_clock = local_i_clock;
-  pPhys.locked = true;
+  struct tpr_c *p = &tpr[victim];
+  TranslationTable *tt = p->owner->translationTable;
+  int pVirt = p->virtualPage;
+
+  // The page is no longer accessible by its owner. While it is copied
+  // in the swap area, a page fault on it waits for the io bit to be cleared
+  p->locked = true;
+  tt->clearBitValid(pVirt);
+
+  // Modified pages of a shared file mapping go back to the file
+  Region *r = p->owner->FindRegion(pVirt);
+  if (tt->getBitM(pVirt) && r != NULL && r->shared)
+  {
+    tt->setBitIo(pVirt);
+    r->WritePage(pVirt, (char*)&(g_machine->mainMemory[victim*g_cfg->PageSize]));
+    tt->clearBitM(pVirt);
+    tt->clearBitIo(pVirt);
+  }
 
   // If page has been modified, put it in swap
-  if(tt->getBitM(pVirt))
+  if (tt->getBitM(pVirt))
   {
-    secteur = g_swap_manager->PutPageSwap(-1, (char*)g_machine->mainMemory[local_i_clock*g_cfg->PageSize]);
-    tt->setAddrDisk(pVirt,secteur);
+    tt->setBitIo(pVirt);
+    int sector = g_swap_manager->PutPageSwap(tt->getBitSwap(pVirt) ? tt->getAddrDisk(pVirt) : -1,
+					      (char*)&(g_machine->mainMemory[victim*g_cfg->PageSize]));
+    if (sector == -1)
+    {
+      printf("Not enough space in the swap area\n");
+      g_machine->interrupt->Halt(-1);
+    }
+    tt->setAddrDisk(pVirt,sector);
     tt->setBitSwap(pVirt);
+    tt->clearBitM(pVirt);
+    tt->clearBitIo(pVirt);
   }
-  return local_i_clock;
+  return victim;
 #endif
 #ifndef ETUDIANTS_TP
 	printf("**** Warning: page replacement algorithm is not implemented yet\n");
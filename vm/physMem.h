@@ -41,10 +41,18 @@ public:
   PhysicalMemManager();   //!< initialize the memory manager
   ~PhysicalMemManager();  //!< de-allocate the page_flags bitmap
 
-  int AddPhysicalToVirtualMapping(AddrSpace* owner,int vp); //!< Finds a new page and adds a new page mapping
+  int AddPhysicalToVirtualMapping(AddrSpace* owner,int vp,bool *zeroed = NULL); //!< Finds a new page and adds a new page mapping
   void RemovePhysicalToVirtualMapping(long numPage); //!< Frees the page and deletes the existing page mapping
   void ChangeOwner(long numPage, Thread* owner);   //!< Change the page owner
   void UnlockPage(long numPage); //!< Unlock physical page
+  void LockPage(long numPage); //!< Lock physical page (see Mlock)
+  void DetachPage(long numPage); //!< Take a page from its owner, the page becomes a locked kernel page
+  void AttachPage(long numPage, AddrSpace* owner, int virtualPage); //!< Give a kernel page to an address space
+  int NumLockedPages(void); //!< Number of locked physical pages
+  bool IsLocked(long numPage) { return tpr[numPage].locked; } //!< True if a physical page is locked
+  bool HasFreePage(void) { return !free_page_list.IsEmpty() || !zeroed_page_list.IsEmpty(); } //!< True if a page is available without eviction
+  void ZeroFreePages(void); //!< Refill the pool of pre-zeroed pages (idle time)
+  void WaitForAdmission(void); //!< Delay the creation of a thread until there is enough memory
   void Print(void); //!< Print the contents of a page
  
 private:
@@ -57,15 +65,21 @@ private:
     bool free;  		//!< true if page is free
     bool locked;              //!< true if page is locked in memory (system page or page under sap in/out)
     int virtualPage;		//!< Number of the virtualPage which references this real page
-    AddrSpace* owner;	//!< Address space of the owner process
+    AddrSpace* owner;	//!< Address space of the owner process (NULL for a kernel page)
   }; 
 
   struct tpr_c *tpr;	//!< RealPage Array to know the state of each real page
 
   Listint free_page_list; //!< List of available (unused) real page numbers
+  Listint zeroed_page_list; //!< List of available real page numbers already filled with zeroes
+  int nb_zeroed_pages;    //!< Number of pages in zeroed_page_list
 
   int i_clock;          //!< Index for clock_algorithm
 
+  bool CanAdmit(void);           //!< True if the working sets leave room for a new thread
+  int admission_next_ticket;    //!< Ticket of the next thread waiting for admission
+  int admission_serving;        //!< Ticket of the thread at the head of the admission queue
+
   friend class AddrSpace;      //!< Direct access to page table for programm loading
 };
 